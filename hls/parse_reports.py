@@ -2,6 +2,8 @@ import re, os, sys
 
 module=sys.argv[1]
 clk_per=sys.argv[2]
+# optional label for the module_name column, e.g. the firTop variant
+label=sys.argv[3] if len(sys.argv)>3 else module
 
 results=open('results.csv','a')
 
@@ -15,7 +17,7 @@ results.write(open('hls.begin').readlines()[0].strip()+',')
 # date__end
 results.write(open('hls').readlines()[0].strip()+',')
 # module_name
-results.write(module+',')
+results.write(label+',')
 # clk_per
 results.write(clk_per+',')
 
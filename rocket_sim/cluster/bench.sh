@@ -0,0 +1,16 @@
+#!/bin/sh
+# Aggregate FIR throughput for 1..16 units.  Rebuilds sc/main.x for
+# each cluster size, runs cluster.c and tabulates samples/s with the
+# share of the simulated time the memory controller port was busy.
+
+UNITS=${UNITS:-"1 2 4 8 16"}
+
+printf "%6s %14s %10s\n" units samples/s mem-busy
+for n in $UNITS; do
+  (cd ../../sc && make clean > /dev/null && make FIR_UNITS=$n > /dev/null) || exit 1
+  make clean > /dev/null
+  make FIR_UNITS=$n sim > cluster.$n.log 2>&1 || exit 1
+  sps=$(sed -n 's/.*samples\/s: \([0-9]*\).*/\1/p' cluster.$n.log)
+  busy=$(sed -n 's/^.*mem busy .*(\(.*\)%)$/\1/p' cluster.$n.log)
+  printf "%6s %14s %9s%%\n" $n "$sps" "$busy"
+done
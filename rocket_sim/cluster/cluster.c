@@ -0,0 +1,67 @@
+
+#include <stdio.h>
+
+// Throughput of a cluster of FIR units fed by the work distributor.
+// FIR_UNITS must match the sc/main.x build, see bench.sh.
+
+#ifndef FIR_UNITS
+#define FIR_UNITS 1
+#endif
+
+#define JOBS 64
+#define LEN 512     // samples per job
+#define SLOTS 16    // 1 KB buffers, inputs at 0x8000, outputs at 0xC000
+
+#define UNIT(k) (0x70010000L + (k)*0x10000L) // CPU view
+#define DISP UNIT(FIR_UNITS)                 // dispatcher after the last unit
+
+int main( int argc, char* argv[] )
+{
+  volatile long long *llp;
+  volatile long long **llpp;
+  long long t0,t1;
+
+  // The buffers are not initialized: only the throughput is measured.
+
+  for (int k=0; k<FIR_UNITS; k++) {
+    llpp=(volatile long long**)0x70000010; // dma sr
+    *llpp=(volatile long long*)0x00004000; // memctl coef1 address
+    llpp=(volatile long long**)0x70000018; // dma dr
+    *llpp=(volatile long long*)(UNIT(k)-0x60000000+0x10); // fir tap coef
+    llp=(volatile long long*)0x70000020;   // dma len
+    *llp=(volatile long long)32; // starts transfer
+    llp=(volatile long long*)0x70000000;   // dma st
+    while (*llp);
+
+    llp=(volatile long long*)UNIT(k);      // reset status register
+    *llp=0;
+    llp=(volatile long long*)(UNIT(k)+8);  // fir ctrl
+    *llp=(volatile long long)0x06;         // load coefficient set 0
+    llp=(volatile long long*)UNIT(k);
+    while((*llp & 0x03) != 0x03);
+  }
+  printf("cpu main %d units loaded\n",FIR_UNITS);
+
+  llp=(volatile long long*)(DISP+0x48);   // dispatcher now
+  t0=*llp;
+  for (int j=0; j<JOBS; j++) {
+    *(volatile long long*)(DISP+0x08)=0x40;   // ctrl: stored set 0
+    *(volatile long long*)(DISP+0x10)=0;      // cfg
+    *(volatile long long*)(DISP+0x18)=0x8000+(j%SLOTS)*2*LEN; // sr
+    *(volatile long long*)(DISP+0x20)=0xC000+(j%SLOTS)*2*LEN; // dr
+    *(volatile long long*)(DISP+0x28)=LEN;    // len
+    *(volatile long long*)(DISP+0x30)=1;      // queue the job
+  }
+  llp=(volatile long long*)DISP;          // dispatcher st
+  while (*llp);
+  llp=(volatile long long*)(DISP+0x48);
+  t1=*llp;
+
+  printf("cpu main units: %d jobs: %ld samples: %ld time: %ld ns\n",
+         FIR_UNITS,(long)*(volatile long long*)(DISP+0x38),(long)JOBS*LEN,(long)(t1-t0));
+  printf("cpu main samples/s: %ld\n",(long)(JOBS*LEN*1000000000LL/(t1-t0)));
+
+  // the exit code on unit 0 stops the simulation, so memctl reports
+  // its busy time and bench.sh moves on to the next cluster size
+  *(volatile long long*)(UNIT(0)+8)=0x0f;
+}
@@ -0,0 +1,290 @@
+#include <stdio.h>
+
+// Self-checking run of the firUnit job modes on unit 0: polyphase
+// output counts, context save/restore, complex jobs, the statistics
+// registers and filter-bank jobs.  Every result is compared against a
+// reference computed here, so "cpu main features error: 0" is a pass.
+// The register map is that of the default build (16 taps, 16 sample
+// blocks, 16 bit samples, 4 coefficient sets, 4 channels).
+
+#define TAPS 16
+#define BLOCK 16
+#define TSTEP 48
+
+#define UNIT 0x70010000L                    // CPU view of unit 0
+#define MEM 0x60000000L                     // CPU view of memctl
+#define REG(r) (*(volatile long long*)(UNIT + 8*(r)))
+#define SAMPLES(a) ((volatile short*)(MEM + (a)))
+
+// firUnit registers
+#define STATUS 0
+#define CTRL 1
+#define COEF 2
+#define IN 6
+#define OUT 10
+#define SRC 22
+#define DST 23
+#define LEN 24
+#define CFG 29
+#define CTX 30
+#define BANK_SETS 31
+#define BANK_STRIDE 32
+#define THRESH 33
+#define ENERGY 34
+#define PEAK 35
+
+// control register fields
+#define START 0x2
+#define MASTER 0x4
+#define LOAD_COEF 0x6
+#define SAVE 0x7
+#define RESTORE 0x8
+#define BANK 0x9
+#define STORED 0x40
+#define SET(s) ((long long)(s) << 8)
+#define CHAN(c) ((long long)(c) << 16)
+
+// cfg register fields
+#define TAPS_CFG(t) ((long long)(t))
+#define DECIM(m) ((long long)(m) << 8)
+#define INTERP(l) ((long long)(l) << 16)
+#define SHIFT(s) ((long long)(s) << 24)
+#define CPLX (1LL << 31)
+#define CPLX_COEF (1LL << 32)
+#define STATS (1LL << 33)
+
+// unit-view memctl buffers
+#define COEF_ADDR 0x4000                    // coef.inc, preloaded
+#define INPUT_ADDR 0x2000                   // input.inc, preloaded
+#define SRC_ADDR 0x8000
+#define DST_ADDR 0x9000
+#define BANK_ADDR 0xA000
+#define CTX_ADDR 0xB000
+
+short coef[TAPS];
+short input[TSTEP];
+short bankCoef[3][TAPS];
+short cplxCoef[TAPS];                       // 8 complex taps, I then Q
+int errors;
+
+// Run one command; the control register is cleared first because only
+// a change of it starts the unit
+void command(long long ctrl)
+{
+  REG(STATUS) = 0;
+  REG(CTRL) = 0;
+  REG(CTRL) = ctrl;
+  while ((REG(STATUS) & 0x03) != 0x03);
+}
+
+void load_set(int set, const short *w)
+{
+  for (int r = 0; r < TAPS/4; r++) {
+    unsigned long long word = 0;
+    for (int i = 0; i < 4; i++)
+      word |= (unsigned long long)(unsigned short)w[4*r + i] << (16*i);
+    REG(COEF + r) = word;
+  }
+  command(LOAD_COEF | SET(set));
+}
+
+// Register job on n inputs of x, the outputs are left in the out registers
+long long block(long long ctrl, long long cfg, const short *x, int n)
+{
+  for (int r = 0; r < BLOCK/4; r++) {
+    unsigned long long word = 0;
+    for (int i = 0; i < 4; i++)
+      if (4*r + i < n)
+        word |= (unsigned long long)(unsigned short)x[4*r + i] << (16*i);
+    REG(IN + r) = word;
+  }
+  REG(CFG) = cfg;
+  command(START | STORED | ctrl);
+  return REG(STATUS);
+}
+
+short output(int i)
+{
+  return (short)(REG(OUT + i/4) >> (16*(i%4)));
+}
+
+// Accumulator of output k over x zero-stuffed by l, 32 bits like the unit's
+int ref(const short *w, int taps, const short *x, int k, int l)
+{
+  int acc = 0;
+  for (int m = 0; m < taps; m++) {
+    int u = k - taps + 1 + m;
+    if (u >= 0 && u % l == 0)
+      acc += w[m]*x[u/l];
+  }
+  return acc;
+}
+
+// Complex accumulators of output n over the I/Q pairs of x
+void ref_cplx(const short *w, int taps, int cc, const short *x, int n, int *ai, int *aq)
+{
+  *ai = 0;
+  *aq = 0;
+  for (int m = 0; m < taps; m++) {
+    int k = n - taps + 1 + m;
+    if (k < 0)
+      continue;
+    int wr = cc ? w[2*m] : w[m];
+    int wi = cc ? w[2*m + 1] : 0;
+    *ai += wr*x[2*k] - wi*x[2*k + 1];
+    *aq += wr*x[2*k + 1] + wi*x[2*k];
+  }
+}
+
+void check(const char *what, long long got, long long want)
+{
+  if (got != want) {
+    printf("cpu main %s: 0x%lx (0x%lx expected)\n", what, (long)got, (long)want);
+    errors++;
+  }
+}
+
+// Channel 1, decimation by 3 over three blocks.  The context is saved
+// after the second block, the channel is then run at another rate on
+// other data, and restoring the context must continue the stream.
+void polyphase(void)
+{
+  const long long cfg = DECIM(3);
+  const long long ctrl = CHAN(1);
+  int first = errors;
+
+  for (int b = 0; b < 2; b++) {
+    long long st = block(ctrl, cfg, input + b*BLOCK, BLOCK);
+    int n = 0;
+    for (int k = b*BLOCK; k < (b + 1)*BLOCK; k++)
+      if (k % 3 == 0)
+        check("decimated output", output(n++), (short)ref(coef, TAPS, input, k, 1));
+    check("decimated count", (st >> 8) & 0xffff, n);
+  }
+
+  REG(CTX) = CTX_ADDR;
+  command(SAVE | CHAN(1));
+  block(ctrl, DECIM(2), input + 32, BLOCK);
+  command(RESTORE | CHAN(1));
+
+  long long st = block(ctrl, cfg, input + 2*BLOCK, BLOCK);
+  int n = 0;
+  for (int k = 2*BLOCK; k < 3*BLOCK; k++)
+    if (k % 3 == 0)
+      check("restored output", output(n++), (short)ref(coef, TAPS, input, k, 1));
+  check("restored count", (st >> 8) & 0xffff, n);
+  printf("cpu main polyphase and context error: %d\n", errors - first);
+}
+
+// Channel 2, 13 taps interpolated by 2 and decimated by 3
+void resample(void)
+{
+  const long long cfg = TAPS_CFG(13) | DECIM(3) | INTERP(2);
+  int first = errors;
+
+  for (int b = 0; b < 3; b++) {
+    long long st = block(CHAN(2), cfg, input + b*BLOCK/2, BLOCK/2);
+    int n = 0;
+    for (int k = b*BLOCK; k < (b + 1)*BLOCK; k++)
+      if (k % 3 == 0)
+        check("resampled output", output(n++), (short)ref(coef, 13, input, k, 2));
+    check("resampled count", (st >> 8) & 0xffff, n);
+  }
+  printf("cpu main resample error: %d\n", errors - first);
+}
+
+// Channel 3, two blocks with 5 real taps, then one with complex taps
+void complex_jobs(void)
+{
+  int first = errors;
+
+  for (int b = 0; b < 3; b++) {
+    int cc = b == 2;
+    long long cfg = cc ? TAPS_CFG(8) | CPLX | CPLX_COEF : TAPS_CFG(5) | CPLX;
+    block(CHAN(3) | SET(cc ? 3 : 0), cfg, input + b*BLOCK, BLOCK);
+    for (int j = 0; j < BLOCK/2; j++) {
+      int ai, aq;
+      ref_cplx(cc ? cplxCoef : coef, cc ? 8 : 5, cc, input, b*BLOCK/2 + j, &ai, &aq);
+      check("complex I", output(2*j), (short)ai);
+      check("complex Q", output(2*j + 1), (short)aq);
+    }
+  }
+  printf("cpu main complex error: %d\n", errors - first);
+}
+
+// Channel 0, a bus-master job with statistics over the first 32 inputs,
+// then a filter bank of sets 0 to 2 over the last 16
+void stats_and_bank(void)
+{
+  volatile short *src = SAMPLES(SRC_ADDR);
+  volatile short *dst = SAMPLES(DST_ADDR);
+  long long energy = 0, peak = 0, index = 0;
+  int first = errors;
+
+  for (int i = 0; i < TSTEP; i++)
+    src[i] = input[i];
+
+  REG(CFG) = SHIFT(2) | STATS;
+  REG(SRC) = SRC_ADDR;
+  REG(DST) = DST_ADDR;
+  REG(LEN) = 2*BLOCK;
+  for (int k = 0; k < 2*BLOCK; k++) {
+    short y = (short)(ref(coef, TAPS, input, k, 1) >> 2);
+    long long mag = y < 0 ? -y : y;
+    energy += y*y;
+    if (mag > peak) {
+      peak = mag;
+      index = k;
+    }
+  }
+  REG(THRESH) = peak;
+  command(MASTER | STORED);
+  long long st = REG(STATUS);
+  for (int k = 0; k < 2*BLOCK; k++)
+    check("stats output", dst[k], (short)(ref(coef, TAPS, input, k, 1) >> 2));
+  check("energy", REG(ENERGY), energy);
+  check("peak", REG(PEAK), peak | index << 32 | 1LL << 48);
+  check("threshold status", (st >> 5) & 1, 1);
+
+  REG(CFG) = 0;
+  REG(SRC) = SRC_ADDR + 2*2*BLOCK;
+  REG(DST) = BANK_ADDR;
+  REG(LEN) = BLOCK;
+  REG(BANK_SETS) = 3;
+  REG(BANK_STRIDE) = 0x100;
+  command(BANK | STORED);
+  for (int s = 0; s < 3; s++) {
+    volatile short *out = SAMPLES(BANK_ADDR + s*0x100);
+    for (int k = 2*BLOCK; k < 3*BLOCK; k++)
+      check("bank output", out[k - 2*BLOCK], (short)ref(bankCoef[s], TAPS, input, k, 1));
+  }
+  printf("cpu main stats and bank error: %d\n", errors - first);
+}
+
+int main( int argc, char* argv[] )
+{
+  for (int i = 0; i < TAPS; i++)
+    coef[i] = SAMPLES(COEF_ADDR)[i];
+  for (int i = 0; i < TSTEP; i++)
+    input[i] = SAMPLES(INPUT_ADDR)[i];
+  for (int s = 0; s < 3; s++)
+    for (int i = 0; i < TAPS; i++)
+      bankCoef[s][i] = coef[(i + 5*s) % TAPS] - s;
+  for (int i = 0; i < TAPS; i++)
+    cplxCoef[i] = coef[i]/4 + i - 8;
+
+  load_set(0, bankCoef[0]);
+  load_set(1, bankCoef[1]);
+  load_set(2, bankCoef[2]);
+  load_set(3, cplxCoef);
+
+  polyphase();
+  resample();
+  complex_jobs();
+  stats_and_bank();
+
+  printf("cpu main features error: %d\n", errors);
+
+  // the exit code on unit 0 stops the simulation
+  REG(CTRL) = 0x0f;
+}
@@ -103,7 +103,7 @@ int main( int argc, char* argv[] )
     //printf("cpu main k: %d output: %d expected %d\n",n,output[n],expected[n]);
   }
 
-  printf("cpu main error: %d\n",error);
+  printf("cpu main error: %d\n",total_error);
 
   llp=(volatile long long*)0x70010008;
   *llp=(volatile long long)0x0f; 
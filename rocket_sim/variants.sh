@@ -0,0 +1,19 @@
+#!/bin/sh
+# Runs fir.c on firUnit variants that must reproduce expected.inc bit
+# for bit.  Rebuilds sc/main.x for each variant (make variables, e.g.
+# "FIR_FFT_TAPS=16") and fails unless fir.c reports a total error of 0.
+
+VARIANTS=${VARIANTS:-"FIR_FFT_TAPS=16 FIR_CONST_COEFS=1"}
+
+status=0
+printf "%-24s %s\n" variant error
+for v in $VARIANTS; do
+  (cd ../sc && make clean > /dev/null && make $v > /dev/null) || exit 1
+  make clean > /dev/null
+  make sim > variant.log 2>&1 || exit 1
+  err=$(sed -n 's/.*cpu main error: \(-*[0-9]*\).*/\1/p' variant.log)
+  printf "%-24s %s\n" $v "$err"
+  [ "$err" = 0 ] || status=1
+done
+(cd ../sc && make clean > /dev/null && make > /dev/null)
+exit $status
@@ -0,0 +1,49 @@
+/*
+ * AxiSlaveTie module
+ *
+ * Terminates an AXI master port that is never used, such as the
+ * bus-master port of a stream-only firUnit stage.  It only resets
+ * the slave side of the channels, so a master that does issue a
+ * request will stall rather than run on with bogus data.
+ */
+
+#ifndef __AXISLAVETIE_H__
+#define __AXISLAVETIE_H__
+
+#include <systemc.h>
+#include <ac_reset_signal_is.h>
+
+#include <axi/axi4.h>
+#include <nvhls_connections.h>
+
+template <typename axiCfg>
+class AxiSlaveTie : public sc_module {
+ public:
+  typedef axi::axi4<axiCfg> axi4_;
+
+  typename axi4_::read::template slave<> if_rd;
+  typename axi4_::write::template slave<> if_wr;
+
+  sc_in<bool> reset_bar;
+  sc_in<bool> clk;
+
+  SC_HAS_PROCESS(AxiSlaveTie);
+  AxiSlaveTie(sc_module_name name)
+      : sc_module(name), if_rd("if_rd"), if_wr("if_wr"),
+        reset_bar("reset_bar"), clk("clk") {
+    SC_THREAD(run);
+    sensitive << clk.pos();
+    async_reset_signal_is(reset_bar, false);
+  }
+
+ protected:
+  void run() {
+    if_rd.reset();
+    if_wr.reset();
+    while (1) {
+      wait();
+    }
+  }
+};
+
+#endif
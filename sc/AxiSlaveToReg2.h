@@ -24,6 +24,7 @@
 #define __AXISLAVETOREG2_H__
 
 #include <systemc.h>
+#include <type_traits>
 #include <ac_int.h>
 #include <hls_globals.h>
 #include <axi/axi4.h>
@@ -38,9 +39,20 @@
  * \tparam axiCfg                   A valid AXI config.
  * \tparam numReg                   The number of registers in the slave.  Each register has a width equivalent to the AXI data width.
  * \tparam numAddrBitsToInspect     The number of address bits to inspect when determining which slave to direct traffic to.  If this is less than the full address width, the routing determination will be made based on the number of address LSBs specified.  (Default: axiCfg::addrWidth)
+ * \tparam perfCounters             Keep free-running performance counters, readable after the numReg registers.  (Default: false)
+ * \tparam numRoReg                 The number of registers at the end of the register bank that only regIn can write; AXI writes to them are ignored.  (Default: 0)
  *
  * \par Overview
- * AxiSlaveToReg is an AXI slave that saves its state in a bank of registers.  The register state is accessible as an array of sc_out.
+ * AxiSlaveToReg is an AXI slave that saves its state in a bank of registers.  The register state is accessible as an array of sc_out, and only the registers written in a cycle are written to it.
+ *
+ * \par Performance Counters
+ * With perfCounters set, numPerf read-only registers follow the numReg
+ * registers in the address map, in the order of the perf enum: clock
+ * cycles with the busy input high and low, cycles a regIn write waited
+ * for the arbiter, and AXI read and write data beats served.  They count
+ * from reset and ignore writes.  busy is an input port only when
+ * perfCounters is set; otherwise it is an internal signal that stays low
+ * and needs no binding.
  *
  * \par Usage Guidelines
  *
@@ -57,7 +69,7 @@
  * \par
  *
  */
-template <typename axiCfg, int numReg, int numAddrBitsToInspect = axiCfg::addrWidth>
+template <typename axiCfg, int numReg, int numAddrBitsToInspect = axiCfg::addrWidth, bool perfCounters = false, int numRoReg = 0>
 class AxiSlaveToReg2 : public sc_module {
  public:
   static const int kDebugLevel = 0;
@@ -70,12 +82,18 @@ class AxiSlaveToReg2 : public sc_module {
   typename axi4_::read::template slave<> if_axi_rd;
   typename axi4_::write::template slave<> if_axi_wr;
 
-  static const int regAddrWidth = nvhls::log2_ceil<numReg>::val;
+  enum { perfBusy, perfIdle, perfStall, perfRdBeat, perfWrBeat, numPerf };
+  static const int numPerfReg = perfCounters ? numPerf : 0;
+
+  static const int regAddrWidth = nvhls::log2_ceil<numReg + numPerfReg>::val;
   static const int bytesPerReg = axi4_::DATA_WIDTH >> 3;
   static const int axiAddrBitsPerReg = nvhls::log2_ceil<bytesPerReg>::val;
 
   sc_in<NVUINTW(numAddrBitsToInspect)> baseAddr;
 
+  // Owner is busy this cycle, for the busy and idle counters
+  typename std::conditional<perfCounters, sc_in<bool>, sc_signal<bool> >::type busy;
+
   // Each reg is one AXI data word
   sc_out<NVUINTW(axi4_::DATA_WIDTH)> regOut[numReg];
 
@@ -113,6 +131,7 @@ class AxiSlaveToReg2 : public sc_module {
         reset_bar("reset_bar"),
         if_axi_rd("if_axi_rd"),
         if_axi_wr("if_axi_wr"),
+        busy("busy"),
         regIn("regIn")
   {
     SC_THREAD(run);
@@ -127,13 +146,20 @@ class AxiSlaveToReg2 : public sc_module {
     regIn.Reset();
     
     NVUINTW(axi4_::DATA_WIDTH) reg[numReg];
-    NVUINTW(numAddrBitsToInspect) maxValidAddr = baseAddr.read() + bytesPerReg*numReg - 1;
+    bool dirty[numReg];  // written this cycle, so regOut needs an update
+    NVUINTW(axi4_::DATA_WIDTH) perf[numPerf];
+    NVUINTW(numAddrBitsToInspect) maxValidAddr = baseAddr.read() + bytesPerReg*(numReg + numPerfReg) - 1;
 
 #pragma hls_unroll yes
     for (int i=0; i<numReg; i++) {
       reg[i] = 0;
+      dirty[i] = 0;
       regOut[i].write(reg[i]);
     }
+#pragma hls_unroll yes
+    for (int i=0; i<numPerf; i++) {
+      perf[i] = 0;
+    }
 
     typename axi4_::AddrPayload axi_rd_req;
     typename axi4_::ReadPayload axi_rd_resp;
@@ -204,11 +230,16 @@ class AxiSlaveToReg2 : public sc_module {
         if (valid_rd_addr) {
           axi_rd_resp.resp = axi4_::Enc::XRESP::OKAY;
           NVUINTW(axi4_::DATA_WIDTH) read_data;
-          axi_rd_resp.data = reg[regAddr];
+          if (regAddr < numReg) {
+            axi_rd_resp.data = reg[regAddr];
+          } else {
+            axi_rd_resp.data = perf[regAddr - numReg];
+          }
         } 
         else {
           axi_rd_resp.resp = axi4_::Enc::XRESP::SLVERR;
         }
+        if (perfCounters) perf[perfRdBeat]++;
         if (axiRdLen == 0) {
           axi_rd_resp.last = 1;
           read_arb_req = 0;
@@ -228,6 +259,7 @@ class AxiSlaveToReg2 : public sc_module {
         // cout << "S2R Check 4.1\n";
         if (if_axi_wr.w.PopNB(axi_wr_req_data)) {
           // cout << "S2R Check 4.2\n";
+          if (perfCounters) perf[perfWrBeat]++;
           valid_wr_addr = (axiWrAddr >= baseAddr.read() && axiWrAddr <= maxValidAddr);
           // cout << "S2R Check 4.2.0\n";
           if (!valid_wr_addr) cout << "Write address " << axiWrAddr << " is out of bounds: [" << baseAddr.read() << "," << maxValidAddr << "]" << endl;
@@ -239,7 +271,7 @@ class AxiSlaveToReg2 : public sc_module {
           // cout << "S2R Check 4.2.3\n";
           if (!axi_wr_req_data.wstrb.and_reduce()) { // Non-uniform write strobe - need to do read-modify-write
             // cout << "S2R Check 4.2.4\n";
-            NVUINTW(axi4_::DATA_WIDTH) old_data = reg[regAddr];
+            NVUINTW(axi4_::DATA_WIDTH) old_data = regAddr < numReg ? reg[regAddr] : NVUINTW(axi4_::DATA_WIDTH)(0);
 #pragma hls_unroll yes
             // cout << "S2R Check 4.2.5\n";
             for (int i=0; i<axi4_::WSTRB_WIDTH; i++) {
@@ -251,8 +283,9 @@ class AxiSlaveToReg2 : public sc_module {
 #pragma hls_unroll yes
           // cout << "S2R Check 4.3\n";
           for (int i=0; i<numReg; i++) { // More verbose, but this is the preferred coding style for HLS
-            if (i == regAddr) {
+            if (i == regAddr && i < numReg - numRoReg) {
               reg[i] = axiData;
+              dirty[i] = 1;
             }
           }
           // cout << "S2R Check 4.4\n";
@@ -280,6 +313,7 @@ class AxiSlaveToReg2 : public sc_module {
         }
       } else if (select_mask == 4) {
         reg[regwr.addr>>3]=regwr.data;
+        dirty[regwr.addr>>3]=1;
         CDCOUT(sc_time_stamp() << " " << name() << " Wrote to local reg from regIn:"
                         << " addr=" << hex << regwr.addr
                         << " data=" << hex << regwr.data
@@ -288,10 +322,19 @@ class AxiSlaveToReg2 : public sc_module {
         arb_needs_update = 1;
         // cout << sc_time_stamp() << " S2R wrote " << regwr << endl;
       }
+      if (perfCounters) {
+        if (busy.read()) perf[perfBusy]++;
+        else perf[perfIdle]++;
+        // a regIn write that was pending at arbitration but not picked
+        if (valid_mask[2] && select_mask != 4) perf[perfStall]++;
+      }
 #pragma hls_unroll yes
       // cout << "S2R Check 5\n";
       for (int i=0; i<numReg; i++) {
-        regOut[i].write(reg[i]);
+        if (dirty[i]) {
+          regOut[i].write(reg[i]);
+          dirty[i] = 0;
+        }
       }
     }
   }
@@ -0,0 +1,161 @@
+/*
+ * AxiToTlm module
+ *
+ * This module is the reverse of TlmToAxi: it is a MatchLib AXI
+ * slave that lets a bus-mastering accelerator reach the TLM
+ * memory system.  Each AXI read or write burst is collected
+ * into a single TLM b_transport call on the initiator socket,
+ * so a burst of N beats costs one transaction on the TLM bus.
+ * The read data or write response is then returned on the
+ * AXI channels one beat per clock, with SLVERR if the TLM
+ * transaction failed.  Write strobes are honoured by writing
+ * only the runs of enabled bytes, since the TLM targets ignore
+ * byte enables; a fully strobed burst is still one transaction.
+ */
+
+#ifndef __AXITOTLM_H__
+#define __AXITOTLM_H__
+
+#include <systemc.h>
+#include <tlm.h>
+#include <ac_reset_signal_is.h>
+
+#include <axi/axi4.h>
+#include <nvhls_connections.h>
+#include <hls_globals.h>
+#include <cstring>
+
+template <typename axiCfg>
+class AxiToTlm
+  : public sc_module
+  , virtual public tlm::tlm_bw_transport_if<>
+{
+ public:
+  static const int kDebugLevel = 0;
+  typedef axi::axi4<axiCfg> axi4_;
+
+  static const int bytesPerBeat = axi4_::DATA_WIDTH >> 3;
+  static const int maxBurstBytes = axiCfg::maxBurstSize * bytesPerBeat;
+  static_assert(bytesPerBeat == sizeof(long long), "Beats are moved as 64 bit words");
+
+  typename axi4_::read::template slave<> if_rd;
+  typename axi4_::write::template slave<> if_wr;
+
+  sc_in<bool> reset_bar;
+  sc_in<bool> clk;
+
+  tlm::tlm_initiator_socket<64> master;
+
+  SC_HAS_PROCESS(AxiToTlm);
+  AxiToTlm(sc_module_name name)
+      : sc_module(name), if_rd("if_rd"), if_wr("if_wr"),
+        reset_bar("reset_bar"), clk("clk"), master("master") {
+    master(*this);
+
+    SC_THREAD(run);
+    sensitive << clk.pos();
+    async_reset_signal_is(reset_bar, false);
+  }
+
+ protected:
+  // Returns false if the transaction failed
+  bool transport(tlm::tlm_command command, sc_dt::uint64 addr,
+                 unsigned char *buf, unsigned int length) {
+    sc_core::sc_time delay = sc_core::SC_ZERO_TIME;
+    tlm::tlm_generic_payload gp;
+
+    gp.set_command(command);
+    gp.set_address(addr);
+    gp.set_response_status( tlm::TLM_INCOMPLETE_RESPONSE );
+    gp.set_data_length(length);
+    gp.set_data_ptr(buf);
+
+    master->b_transport(gp, delay);
+    if (gp.is_response_error()) {
+      cout << sc_time_stamp() << " " << name()
+           << " ERROR: TLM transaction to addr:0x" << hex << addr << " failed" << endl;
+      return false;
+    }
+    return true;
+  }
+
+  void run() {
+    typename axi4_::AddrPayload rd_req;
+    typename axi4_::ReadPayload rd_resp;
+    typename axi4_::AddrPayload wr_req;
+    typename axi4_::WritePayload wr_data;
+    typename axi4_::WRespPayload wr_resp;
+
+    unsigned char buf[maxBurstBytes];
+    bool strb[maxBurstBytes];
+    unsigned int beats;
+    long long word;
+    bool ok;
+
+    if_rd.reset();
+    if_wr.reset();
+
+    while (1) {
+      wait();
+
+      if (if_rd.ar.PopNB(rd_req)) {
+        beats = rd_req.len.to_uint() + 1;
+        CDCOUT(sc_time_stamp() << " " << name() << " Received read request: ["
+                      << rd_req << "]" << endl, kDebugLevel);
+        ok = transport(tlm::TLM_READ_COMMAND, rd_req.addr.to_uint64(), buf, beats*bytesPerBeat);
+        // b_transport consumes simulated time, so re-align to the clock
+        wait();
+        for (unsigned int i = 0; i < beats; i++) {
+          rd_resp.id = rd_req.id;
+          rd_resp.resp = ok ? axi4_::Enc::XRESP::OKAY : axi4_::Enc::XRESP::SLVERR;
+          memcpy(&word, &buf[i*bytesPerBeat], bytesPerBeat);
+          rd_resp.data = word;
+          rd_resp.last = (i == beats - 1);
+          if_rd.r.Push(rd_resp);
+        }
+      }
+
+      if (if_wr.aw.PopNB(wr_req)) {
+        beats = wr_req.len.to_uint() + 1;
+        CDCOUT(sc_time_stamp() << " " << name() << " Received write request: ["
+                      << wr_req << "]" << endl, kDebugLevel);
+        for (unsigned int i = 0; i < beats; i++) {
+          wr_data = if_wr.w.Pop();
+          word = wr_data.data.to_int64();
+          memcpy(&buf[i*bytesPerBeat], &word, bytesPerBeat);
+          for (int b = 0; b < bytesPerBeat; b++) {
+            strb[i*bytesPerBeat + b] = wr_data.wstrb[b];
+          }
+        }
+        // one transaction per run of enabled bytes
+        ok = true;
+        for (unsigned int b = 0, e; b < beats*bytesPerBeat; b = e) {
+          for (e = b; e < beats*bytesPerBeat && strb[e]; e++);
+          if (e > b) {
+            ok &= transport(tlm::TLM_WRITE_COMMAND, wr_req.addr.to_uint64() + b, buf + b, e - b);
+          } else {
+            e++;
+          }
+        }
+        wait();
+        if (axiCfg::useWriteResponses) {
+          wr_resp.id = wr_req.id;
+          wr_resp.resp = ok ? axi4_::Enc::XRESP::OKAY : axi4_::Enc::XRESP::SLVERR;
+          if_wr.b.Push(wr_resp);
+        }
+      }
+    }
+  }
+
+/// Not Implemented for this example but required by the initiator socket
+  void invalidate_direct_mem_ptr
+    (sc_dt::uint64 start_range, sc_dt::uint64 end_range) {
+    return;
+  }
+  tlm::tlm_sync_enum nb_transport_bw (tlm::tlm_generic_payload  &gp,
+     tlm::tlm_phase &phase, sc_core::sc_time &delay) {
+    return tlm::TLM_ACCEPTED;
+  }
+};
+
+#endif
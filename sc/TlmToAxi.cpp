@@ -24,16 +24,22 @@ using namespace  std;
 
 
 SC_HAS_PROCESS(TlmToAxi);
-TlmToAxi::TlmToAxi( sc_core::sc_module_name module_name)
+TlmToAxi::TlmToAxi( sc_core::sc_module_name module_name, int numStages)
   : sc_module (module_name),
     master("master"),
     dut("dut"),
+    bridge("bridge"),
     clk("clk", 1.0, SC_NS, 0.5, 0, SC_NS, true),
     reset_bar("reset_bar"),
     axi_read("axi_read"),
-    axi_write("axi_write")
+    axi_write("axi_write"),
+    axi_mst_read("axi_mst_read"),
+    axi_mst_write("axi_mst_write"),
+    sampleIn_chan("sampleIn_chan"),
+    sampleOut_chan("sampleOut_chan")
 {
   slave.register_b_transport(this, &TlmToAxi::custom_b_transport);
+  streamReaders = 0;
 
   Connections::set_sim_clk(&clk);
 
@@ -49,6 +55,62 @@ TlmToAxi::TlmToAxi( sc_core::sc_module_name module_name)
   dut.axi_read(axi_read);
   dut.axi_write(axi_write);
 
+  bridge.clk(clk);
+  bridge.reset_bar(reset_bar);
+  dut.axi_mst_read(axi_mst_read);
+  dut.axi_mst_write(axi_mst_write);
+  bridge.if_rd(axi_mst_read);
+  bridge.if_wr(axi_mst_write);
+
+  dut.sampleIn(sampleIn_chan);
+
+  if (numStages > maxStages) {
+    cout << name() << " WARNING: only " << dec << maxStages << " stages fit the address map" << endl;
+    numStages = maxStages;
+  }
+  for (int k = 1; k < numStages; k++) {
+    stage_t s;
+    std::string n = "stage" + std::to_string(k);
+    s.fir = new firTop((n + "_fir").c_str());
+    s.master = new TlmToAxiMaster<axi::cfg::standard, Mcfg>((n + "_master").c_str());
+    s.tie = new AxiSlaveTie<axi::cfg::standard>((n + "_tie").c_str());
+    s.done = new sc_signal<bool>((n + "_done").c_str());
+    s.axi_read = new typename axi_::read::template chan<>((n + "_axi_read").c_str());
+    s.axi_write = new typename axi_::write::template chan<>((n + "_axi_write").c_str());
+    s.axi_mst_read = new typename axi_::read::template chan<>((n + "_axi_mst_read").c_str());
+    s.axi_mst_write = new typename axi_::write::template chan<>((n + "_axi_mst_write").c_str());
+    s.sampleIn_chan = new Connections::Combinational<firTop::stream_t>((n + "_sampleIn_chan").c_str());
+
+    s.fir->clk(clk);
+    s.fir->reset_bar(reset_bar);
+    s.master->clk(clk);
+    s.master->reset_bar(reset_bar);
+    s.master->done(*s.done);
+    s.master->if_rd(*s.axi_read);
+    s.master->if_wr(*s.axi_write);
+    s.fir->axi_read(*s.axi_read);
+    s.fir->axi_write(*s.axi_write);
+    s.tie->clk(clk);
+    s.tie->reset_bar(reset_bar);
+    s.fir->axi_mst_read(*s.axi_mst_read);
+    s.fir->axi_mst_write(*s.axi_mst_write);
+    s.tie->if_rd(*s.axi_mst_read);
+    s.tie->if_wr(*s.axi_mst_write);
+    s.fir->sampleIn(*s.sampleIn_chan);
+    stages.push_back(s);
+  }
+
+  // chain the stages, the last one feeding the stream window
+  if (stages.empty()) {
+    dut.sampleOut(sampleOut_chan);
+  } else {
+    dut.sampleOut(*stages.front().sampleIn_chan);
+    for (unsigned int k = 0; k + 1 < stages.size(); k++) {
+      stages[k].fir->sampleOut(*stages[k + 1].sampleIn_chan);
+    }
+    stages.back().fir->sampleOut(sampleOut_chan);
+  }
+
   // for (int i = 0; i < numReg; i++) {
   //   dut.regOut[i](regOut[i]);
   // }
@@ -56,6 +118,9 @@ TlmToAxi::TlmToAxi( sc_core::sc_module_name module_name)
   master.done(done);
 
   SC_THREAD(run);
+
+  SC_THREAD(streamRun);
+  sensitive << clk.posedge_event();
 }
 
 void TlmToAxi::run()
@@ -71,6 +136,89 @@ void TlmToAxi::run()
     }
 }
 
+// Moves samples between the TLM stream window and the dut's
+// streaming ports, one sample in and one out per clock at most.
+// With no inputs queued, no read waiting and the chain drained it
+// sleeps until the next stream access instead of waking every clock.
+void TlmToAxi::streamRun()
+{
+    sampleIn_chan.ResetWrite();
+    sampleOut_chan.ResetRead();
+
+    firTop::stream_t sample;
+    int idle = 0;
+    while (1) {
+      wait();
+      if (!sampleInq.empty()) {
+        if (sampleIn_chan.PushNB(sampleInq.front())) {
+          sampleInq.pop();
+          if (sampleInq.empty()) sampleInEmpty.notify(SC_ZERO_TIME);
+          idle = 0;
+        }
+      }
+      if (sampleOut_chan.PopNB(sample)) {
+        sampleOutq.push(sample);
+        sampleOutReady.notify(SC_ZERO_TIME);
+        idle = 0;
+      }
+      if (sampleInq.empty() && streamReaders == 0 && ++idle >= streamDrainClocks) {
+        wait(streamWake);
+        idle = 0;
+      }
+    }
+}
+
+void
+TlmToAxi::stream_b_transport
+ ( tlm::tlm_generic_payload &gp )
+{
+  unsigned long    length    = gp.get_data_length();
+  unsigned char    *dp       = gp.get_data_ptr();
+  unsigned long    i,b;
+  unsigned long long val;
+
+  if (gp.get_address()>=streamCount) {
+    if (gp.get_command()==tlm::TLM_READ_COMMAND) {
+      val=sampleOutq.size();
+      for (b=0; b<length && b<sizeof(val); b++)
+        dp[b]=(unsigned char)(val>>(8*b));
+    }
+  } else if (gp.get_command()==tlm::TLM_WRITE_COMMAND) {
+    for (i=0; i<length/bytesPerSample; i++) {
+      val=0;
+      for (b=0; b<bytesPerSample; b++)
+        val|=(unsigned long long)dp[i*bytesPerSample+b]<<(8*b);
+      sampleInq.push(firTop::stream_t(val));
+    }
+    streamWake.notify(SC_ZERO_TIME);
+    while (!sampleInq.empty())
+      wait(sampleInEmpty);
+  } else {
+    // wait a bounded time for the outputs, so a read past the end of a
+    // decimated or short stream fails instead of hanging the initiator
+    sc_core::sc_time deadline=sc_core::sc_time_stamp()+sc_core::sc_time(streamWaitNs,sc_core::SC_NS);
+    streamReaders++;
+    streamWake.notify(SC_ZERO_TIME);
+    while (sampleOutq.size()<length/bytesPerSample && sc_core::sc_time_stamp()<deadline)
+      wait(deadline-sc_core::sc_time_stamp(), sampleOutReady);
+    streamReaders--;
+    if (sampleOutq.size()<length/bytesPerSample) {
+      cout << sc_core::sc_time_stamp() << " " << sc_object::name()
+           << " ERROR: stream read of " << dec << length/bytesPerSample
+           << " samples, " << sampleOutq.size() << " available" << endl;
+      gp.set_response_status( tlm::TLM_BURST_ERROR_RESPONSE );
+      return;
+    }
+    for (i=0; i<length/bytesPerSample; i++) {
+      val=sampleOutq.front().to_uint64();
+      sampleOutq.pop();
+      for (b=0; b<bytesPerSample; b++)
+        dp[i*bytesPerSample+b]=(unsigned char)(val>>(8*b));
+    }
+  }
+  gp.set_response_status( tlm::TLM_OK_RESPONSE );
+}
+
 void                                        
 TlmToAxi::custom_b_transport
  ( tlm::tlm_generic_payload &gp, sc_core::sc_time &delay )
@@ -100,25 +248,43 @@ TlmToAxi::custom_b_transport
     } 
   }
 
+  if (address >= streamBase) {
+    stream_b_transport(gp);
+    cout << sc_core::sc_time_stamp() << " " << sc_object::name() << " stream transaction complete" << endl;
+    return;
+  }
+
+  // pick the stage whose registers are addressed
+  unsigned int k = address / stageStride;
+  if (k > stages.size()) {
+    cout << sc_core::sc_time_stamp() << " " << sc_object::name()
+          << " ERROR: no stage at addr:0x" << hex << address << endl;
+    gp.set_response_status( tlm::TLM_ADDRESS_ERROR_RESPONSE );
+    return;
+  }
+  TlmToAxiMaster<axi::cfg::standard, Mcfg> &m = k ? *stages[k - 1].master : master;
+  gp.set_address(address % stageStride);
+
   m_mutex.lock();
-  master.inq.push(&gp);
-  wait(master.outpeq.get_event());
-  gpp=master.outpeq.get_next_transaction();
+  m.inq.push(&gp);
+  wait(m.outpeq.get_event());
+  gpp=m.outpeq.get_next_transaction();
   if (gpp!=&gp) {
     cout << sc_core::sc_time_stamp() << " " << sc_object::name() 
           << " ERROR: incomming payload pointer does not match outgoing payload pointer" << endl;
   }
   m_mutex.unlock();
+  gp.set_address(address);
 
   cout << sc_core::sc_time_stamp() << " " << sc_object::name() << " transaction complete" << endl;
 
   if (gp.get_address()==0x08 && command==tlm::TLM_WRITE_COMMAND) {
-    if ((long long)dut.regOut_chan[1].read()==(long long)0x01) {
-      for (int i = 0; i < firUnit::numReg; i++) {
+    if ((long long)dut.regOut_chan[firTop::ctrlReg].read()==(long long)0x01) {
+      for (int i = 0; i < numReg; i++) {
         cout << sc_core::sc_time_stamp() << ' ' << name() << " regOut[" << dec << i << "] = " << hex << dut.regOut_chan[i] << endl;
       }
     }
-    else if ((long long)dut.regOut_chan[1].read()==(long long)0x0f) {
+    else if ((long long)dut.regOut_chan[firTop::ctrlReg].read()==(long long)0x0f) {
       cout << sc_core::sc_time_stamp() << ' ' << name() << " received exit signal" << endl;
       sc_stop();
     }
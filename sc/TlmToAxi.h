@@ -20,7 +20,10 @@
 #include "tlm_utils/simple_target_socket.h"
 #include <axi/axi4.h>
 #include "TlmToAxiMaster.h"
-#include "firUnit.h"
+#include "AxiToTlm.h"
+#include "AxiSlaveTie.h"
+#include "firTop.h"
+#include <vector>
 
 class TlmToAxi: public sc_core::sc_module
 {
@@ -30,15 +33,30 @@ class TlmToAxi: public sc_core::sc_module
   sc_dt::uint64  m_memory_size;
   sc_core::sc_mutex m_mutex;
 
-  TlmToAxi( sc_core::sc_module_name module_name);
+  TlmToAxi( sc_core::sc_module_name module_name, int numStages = 1);
 
   tlm_utils::simple_target_socket<TlmToAxi,buswidth>  slave;
  
-  typedef firUnit::axi_ axi_;
+  typedef firTop::axi_ axi_;
   enum {
-    numReg = firUnit::numReg,
-    numAddrBitsToInspect = firUnit::numAddrBitsToInspect
+    numReg = firTop::numReg,
+    numMappedReg = firTop::numMappedReg,
+    numAddrBitsToInspect = firTop::numAddrBitsToInspect,
+    // Writes at or above streamBase feed dut.sampleIn, reads drain dut.sampleOut
+    streamBase = 0x8000,
+    // Reads at or above streamCount return the number of outputs waiting
+    streamCount = 0xc000,
+    // A read of more outputs than arrive within this time fails
+    streamWaitNs = 1000,
+    // Clocks streamRun keeps polling after the last transfer, so the
+    // stage chain can drain before it sleeps
+    streamDrainClocks = 32,
+    bytesPerSample = firTop::sampleWidth/8,
+    // Registers of chain stage k are at k*stageStride
+    stageStride = 0x1000,
+    maxStages = streamBase/stageStride
   };
+  static_assert(numMappedReg*firTop::bytesPerReg <= stageStride, "firTop registers exceed the stage window");
 
   struct Mcfg {
     enum {
@@ -46,7 +64,7 @@ class TlmToAxi: public sc_core::sc_module
       numReads = 2,
       readDelay = 0,
       addrBoundLower = 0x000,
-      addrBoundUpper = 0x06F,
+      addrBoundUpper = numMappedReg*firTop::bytesPerReg - 1,
       seed = 0,
       useFile = false,
     };
@@ -54,7 +72,10 @@ class TlmToAxi: public sc_core::sc_module
 
   TlmToAxiMaster<axi::cfg::standard, Mcfg> master;
 
-  CCS_DESIGN(firUnit) dut;
+  CCS_DESIGN(firTop) dut;
+
+  // Carries the dut's bus-master traffic back to the TLM bus
+  AxiToTlm<axi::cfg::standard> bridge;
 
   sc_clock clk;
   sc_signal<bool> reset_bar;
@@ -62,6 +83,35 @@ class TlmToAxi: public sc_core::sc_module
 
   typename axi_::read::template chan<> axi_read;
   typename axi_::write::template chan<> axi_write;
+  typename axi_::read::template chan<> axi_mst_read;
+  typename axi_::write::template chan<> axi_mst_write;
+
+  Connections::Combinational<firTop::stream_t> sampleIn_chan;
+  Connections::Combinational<firTop::stream_t> sampleOut_chan;
+  std::queue<firTop::stream_t> sampleInq;
+  std::queue<firTop::stream_t> sampleOutq;
+  sc_core::sc_event sampleInEmpty;
+  sc_core::sc_event sampleOutReady;
+  // Wakes streamRun for a stream access; streamReaders counts the reads
+  // waiting for outputs
+  sc_core::sc_event streamWake;
+  int streamReaders;
+
+  // Stream stages after dut, chained sampleOut to sampleIn so that only
+  // the first input and the last output cross the stream window.  Each
+  // has its own registers; its bus-master port is tied off.
+  struct stage_t {
+    firTop *fir;
+    TlmToAxiMaster<axi::cfg::standard, Mcfg> *master;
+    AxiSlaveTie<axi::cfg::standard> *tie;
+    sc_signal<bool> *done;
+    typename axi_::read::template chan<> *axi_read;
+    typename axi_::write::template chan<> *axi_write;
+    typename axi_::read::template chan<> *axi_mst_read;
+    typename axi_::write::template chan<> *axi_mst_write;
+    Connections::Combinational<firTop::stream_t> *sampleIn_chan;
+  };
+  std::vector<stage_t> stages;
 
   // sc_signal<NVUINTW(axi::axi4<axi::cfg::standard>::DATA_WIDTH)> regOut[numReg];
 
@@ -70,6 +120,11 @@ class TlmToAxi: public sc_core::sc_module
 
   void run();	    
 
+  void streamRun();
+
+  void stream_b_transport
+  ( tlm::tlm_generic_payload &gp );
+
   void custom_b_transport
   ( tlm::tlm_generic_payload &gp, sc_core::sc_time &delay );
 
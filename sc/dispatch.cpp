@@ -0,0 +1,187 @@
+/*************************************************
+
+FIR cluster work distributor
+
+**************************************************/
+
+#include "nvhls_pch.h"
+#include "dispatch.h"
+#include "firTop.h"
+#include <string>
+#include <iostream>
+#include <iomanip>
+
+// Time between status polls of a busy unit
+#define POLL_NS 20
+
+
+using namespace std;
+
+dispatch::dispatch (sc_core::sc_module_name name, int units,
+                    sc_dt::uint64 unitBase, sc_dt::uint64 unitStride)
+  : sc_module(name)
+  , m_units(units)
+  , m_unit_base(unitBase)
+  , m_unit_stride(unitStride)
+{
+    master(*this);
+    slave.register_b_transport(this, &dispatch::custom_b_transport);
+    m_memory_size=sizeof(registers);
+    data=new unsigned char[m_memory_size];
+    for (unsigned int i=0; i<m_memory_size; i++)
+      data[i]=0;
+    regs=reinterpret_cast<registers*>(data);
+    regs->units=units;
+
+    for (int k=0; k<units; k++)
+      sc_core::sc_spawn(sc_bind(&dispatch::worker, this, k),
+                        ("worker" + std::to_string(k)).c_str());
+}
+
+dispatch::~dispatch()
+{
+  delete[] data;
+}
+
+
+// Read or write one 64-bit register of a unit
+void
+dispatch::unit_transport
+ ( int unit, tlm::tlm_command command, int reg, long long &val )
+{
+  sc_core::sc_time delay=sc_core::SC_ZERO_TIME;
+  tlm::tlm_generic_payload  gp;
+
+  gp.set_command(command);
+  gp.set_address(m_unit_base + unit*m_unit_stride + reg*firTop::bytesPerReg);
+  gp.set_response_status( tlm::TLM_INCOMPLETE_RESPONSE );
+  gp.set_data_length(sizeof(val));
+  gp.set_data_ptr(reinterpret_cast<unsigned char*>(&val));
+
+  master->b_transport(gp, delay);
+  if (gp.is_response_error())
+    cout << sc_core::sc_time_stamp() << " " << sc_object::name()
+         << " ERROR: unit " << dec << unit << " register " << reg << " failed" << endl;
+}
+
+
+// Runs the queued jobs on one unit, one at a time
+void
+dispatch::worker(int unit)
+{
+  long long val;
+  int bank=0;
+
+  while (1) {
+    while (m_jobs.empty())
+      wait(m_job_ready);
+    job j=m_jobs.front();
+    m_jobs.pop();
+
+    cout << sc_core::sc_time_stamp() << " " << sc_object::name()
+         << " unit " << dec << unit << " job src:0x" << hex << j.sr
+         << " dst:0x" << j.dr << " len:0x" << j.len << endl;
+
+    unit_transport(unit, tlm::TLM_WRITE_COMMAND, firTop::cfgReg, j.cfg);
+    unit_transport(unit, tlm::TLM_WRITE_COMMAND, firTop::srcAddrReg, j.sr);
+    unit_transport(unit, tlm::TLM_WRITE_COMMAND, firTop::dstAddrReg, j.dr);
+    unit_transport(unit, tlm::TLM_WRITE_COMMAND, firTop::lenReg, j.len);
+    val=0;
+    unit_transport(unit, tlm::TLM_WRITE_COMMAND, firTop::statusReg, val);
+
+    // alternate the bank bit so that every start changes the control word
+    bank^=1;
+    val=(j.ctrl & ~(long long)((1<<firTop::ctrlCmdWidth)-1) & ~(1LL<<firTop::ctrlBankBit))
+        | firTop::cmdMaster | ((long long)bank<<firTop::ctrlBankBit);
+    unit_transport(unit, tlm::TLM_WRITE_COMMAND, firTop::ctrlReg, val);
+
+    do {
+      wait(POLL_NS, sc_core::SC_NS);
+      unit_transport(unit, tlm::TLM_READ_COMMAND, firTop::statusReg, val);
+    } while ((val & firTop::statusDone) != firTop::statusDone);
+
+    m_mutex.lock();
+    regs->done++;
+    regs->st--;
+    m_mutex.unlock();
+  }
+}
+
+
+void
+dispatch::custom_b_transport
+ ( tlm::tlm_generic_payload &gp, sc_core::sc_time &delay )
+{
+  sc_dt::uint64    address   = gp.get_address();
+  tlm::tlm_command command   = gp.get_command();
+  unsigned long    length    = gp.get_data_length();
+  unsigned long    i;
+  unsigned char    *dp       = gp.get_data_ptr();
+  sc_core::sc_time mem_delay(1,sc_core::SC_NS);
+
+  wait(delay);
+  wait(mem_delay);
+  cout << sc_core::sc_time_stamp() << " " << sc_object::name();
+  if (address + length <= m_memory_size) {
+    switch (command) {
+      case tlm::TLM_WRITE_COMMAND:
+      {
+        cout << " WRITE len:0x" << hex << length << " addr:0x" << address << endl;
+        m_mutex.lock();
+        for (i=0; i<length; i++)
+          data[address+i]=dp[i];
+        if (address==0x30) {
+          job j;
+          j.ctrl=regs->ctrl;
+          j.cfg=regs->cfg;
+          j.sr=regs->sr;
+          j.dr=regs->dr;
+          j.len=regs->len;
+          m_jobs.push(j);
+          regs->st++;
+          m_job_ready.notify(sc_core::SC_ZERO_TIME);
+        }
+        m_mutex.unlock();
+        gp.set_response_status( tlm::TLM_OK_RESPONSE );
+        break;
+      }
+      case tlm::TLM_READ_COMMAND:
+      {
+        cout << " READ len:0x" << hex << length << " addr:0x" << address << endl;
+        regs->units=m_units;
+        regs->now=(long long)(sc_core::sc_time_stamp().to_seconds()*1e9);
+        for (i=0; i<length; i++)
+          dp[i]=data[address+i];
+        gp.set_response_status( tlm::TLM_OK_RESPONSE );
+        break;
+      }
+      default:
+      {
+        cout << " ERROR Command " << command << " not recognized" << endl;
+        gp.set_response_status( tlm::TLM_COMMAND_ERROR_RESPONSE );
+      }
+    }
+  }
+  else {
+    cout << " ERROR Address 0x" << hex << address << " out of range" << endl;
+    gp.set_response_status( tlm::TLM_ADDRESS_ERROR_RESPONSE );
+  }
+
+  return;
+}
+
+
+tlm::tlm_sync_enum  dispatch::nb_transport_bw( tlm::tlm_generic_payload &gp,
+                           tlm::tlm_phase &phase, sc_core::sc_time &delay)
+{
+  tlm::tlm_sync_enum status;
+  status = tlm::TLM_ACCEPTED;
+  return status;
+} // end nb_transport_bw
+
+
+void dispatch::invalidate_direct_mem_ptr
+  (sc_dt::uint64 start_range, sc_dt::uint64 end_range)
+{
+    return;
+} // end invalidate_direct_mem_ptr
@@ -0,0 +1,97 @@
+/*************************************************
+
+FIR cluster work distributor
+
+Software queues bus-master jobs (source, destination,
+length, control and cfg words) through a small register
+file; one worker per firUnit takes the next job whenever
+its unit is idle, programs the unit over the TLM bus,
+waits for the done status and counts the completion.
+
+Register map (64 bit, byte offsets):
+  0x00 st    jobs queued or running
+  0x08 ctrl  control word for the next job; the
+             command field is replaced by a bus-master
+             start
+  0x10 cfg   cfg word for the next job
+  0x18 sr    source address of the next job
+  0x20 dr    destination address of the next job
+  0x28 len   number of samples of the next job
+  0x30 push  any write queues the job
+  0x38 done  jobs completed, writable to reset
+  0x40 units number of firUnits (read only)
+  0x48 now   simulated time in ns (read only)
+
+**************************************************/
+
+#ifndef __DISPATCH_H__
+#define __DISPATCH_H__
+
+#include <tlm.h>
+#include "tlm_utils/simple_target_socket.h"
+#include <queue>
+
+
+class dispatch
+  : public sc_core::sc_module
+  , virtual public tlm::tlm_bw_transport_if<>
+{
+  public:
+  static const unsigned int buswidth=64;
+
+  SC_HAS_PROCESS(dispatch);
+  // units: number of firUnits, unit k answering at unitBase+k*unitStride
+  dispatch(sc_core::sc_module_name name, int units,
+           sc_dt::uint64 unitBase, sc_dt::uint64 unitStride);
+
+  ~dispatch();
+
+  tlm::tlm_initiator_socket<buswidth> master;
+  tlm_utils::simple_target_socket<dispatch,buswidth>  slave;
+
+  class registers {
+    public:
+    long long st;
+    long long ctrl;
+    long long cfg;
+    long long sr;
+    long long dr;
+    long long len;
+    long long push;
+    long long done;
+    long long units;
+    long long now;
+  };
+  registers *regs;
+  unsigned char *data;
+  sc_dt::uint64  m_memory_size;
+
+  private:
+  struct job {
+    long long ctrl, cfg, sr, dr, len;
+  };
+  std::queue<job> m_jobs;
+  sc_core::sc_event m_job_ready;
+  sc_core::sc_mutex m_mutex;
+
+  int m_units;
+  sc_dt::uint64 m_unit_base, m_unit_stride;
+
+  void worker(int unit);
+
+  void unit_transport
+  ( int unit, tlm::tlm_command command, int reg, long long &val );
+
+  void custom_b_transport
+  ( tlm::tlm_generic_payload &gp, sc_core::sc_time &delay );
+
+/// Not Implemented for this example but required by the initiator socket
+  void invalidate_direct_mem_ptr
+    (sc_dt::uint64 start_range, sc_dt::uint64 end_range);
+  tlm::tlm_sync_enum nb_transport_bw (tlm::tlm_generic_payload  &gp,
+     tlm::tlm_phase &phase, sc_core::sc_time &delay);
+
+};
+
+
+#endif /* __DISPATCH_H__ */
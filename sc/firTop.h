@@ -0,0 +1,68 @@
+/*
+ * firTop module
+ *
+ * Concrete firUnit variant used as the HLS top level and as the
+ * device under test in TlmToAxi.  The variant is selected at compile
+ * time, e.g. -DFIR_TAPS=64, so the same sources produce every
+ * filter size without editing.
+ */
+
+#ifndef __FIRTOP_H__
+#define __FIRTOP_H__
+
+#include "firUnit.h"
+
+#ifndef FIR_TAPS
+#define FIR_TAPS 16
+#endif
+#ifndef FIR_BLOCK
+#define FIR_BLOCK 16
+#endif
+#ifndef FIR_SAMPLE_BITS
+#define FIR_SAMPLE_BITS 16
+#endif
+#ifndef FIR_ACC_BITS
+#define FIR_ACC_BITS 32
+#endif
+#ifndef FIR_LANES
+#define FIR_LANES 1
+#endif
+#ifndef FIR_COEF_SETS
+#define FIR_COEF_SETS 4
+#endif
+#ifndef FIR_CHANNELS
+#define FIR_CHANNELS 4
+#endif
+#ifndef FIR_OUT_BITS
+#define FIR_OUT_BITS FIR_SAMPLE_BITS
+#endif
+#ifndef FIR_FFT_TAPS
+#define FIR_FFT_TAPS 0
+#endif
+// 1 = the coefficients of coef.inc are built into shift-add networks
+#ifndef FIR_CONST_COEFS
+#define FIR_CONST_COEFS 0
+#endif
+
+// Build-time coefficient table of FIR_CONST_COEFS=1
+struct firCoefInc {
+  static constexpr short val[] = {
+#include "coef.inc"
+  };
+  enum { taps = sizeof(val)/sizeof(val[0]) };
+};
+
+#if FIR_CONST_COEFS
+typedef firCoefInc firTopCoefs;
+#else
+typedef firNoCoefs firTopCoefs;
+#endif
+
+typedef firUnit<FIR_TAPS, FIR_BLOCK, sc_int<FIR_SAMPLE_BITS>, sc_int<FIR_ACC_BITS>, FIR_LANES, FIR_COEF_SETS, FIR_CHANNELS, FIR_OUT_BITS, FIR_FFT_TAPS, firTopCoefs> firTopBase;
+
+class firTop : public firTopBase {
+ public:
+  firTop(sc_module_name name) : firTopBase(name) {}
+};
+
+#endif
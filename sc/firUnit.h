@@ -29,19 +29,550 @@
 
 #include <axi/axi4.h>
 #include "AxiSlaveToReg2.h"
-#include <CombinationalBufferedPorts.h>
 
-#define TAPS 16
-// Pack 4 shorts into 64 bit value
-// SystemC concatenation not compatible with AC_INT, so manually masking & bit shifting instead
-#define SHORTS_TO_LONG(val1, val2, val3, val4) ((((unsigned long long)val4 & 0xFFFF) << 48) | (((unsigned long long)val3 & 0xFFFF) << 32) | (((unsigned long long)val2 & 0xFFFF) << 16) | (((unsigned long long)val1 & 0xFFFF)))
+// Bit width of the sample/accumulator types accepted by firUnit
+template <typename T> struct firTypeWidth;
+template <int W> struct firTypeWidth<sc_int<W> > { enum { val = W }; };
+template <int W> struct firTypeWidth<sc_uint<W> > { enum { val = W }; };
+template <> struct firTypeWidth<short> { enum { val = 16 }; };
+template <> struct firTypeWidth<signed char> { enum { val = 8 }; };
 
+// Coefficient table fixed at build time, for the ConstCoefs parameter of
+// firUnit: enum taps and a constexpr array val[taps], e.g.
+//
+//   struct myCoefs {
+//     enum { taps = 16 };
+//     static constexpr short val[taps] = {
+//   #include "coef.inc"
+//     };
+//   };
+//
+// firNoCoefs (taps = 0) selects the generic multiplier datapath.
+struct firNoCoefs { enum { taps = 0 }; static constexpr short val[1] = { 0 }; };
+
+// x*C as a canonical signed digit shift-add network: the digits of C are
+// taken from the least significant end, each odd remainder contributing
+// +/-(x << Shift) so that no two neighbouring digits are nonzero.
+template <long long C, int Shift = 0>
+struct csdMul {
+  enum {
+    digit = (C & 1) ? ((C & 3) == 3 ? -1 : 1) : 0,
+    adders = (digit != 0) + csdMul<(C - digit)/2, Shift + 1>::adders
+  };
+
+  template <typename AccT>
+  static AccT mul(const AccT &x)
+  {
+    AccT r = csdMul<(C - digit)/2, Shift + 1>::mul(x);
+    if (digit > 0) r += AccT(x << Shift);
+    if (digit < 0) r -= AccT(x << Shift);
+    return r;
+  }
+};
+
+template <int Shift>
+struct csdMul<0, Shift> {
+  enum { adders = 0 };
+
+  template <typename AccT>
+  static AccT mul(const AccT &x)
+  {
+    return 0;
+  }
+};
+
+// First and last nonzero tap of a constant table, so the zero taps at
+// both ends get no hardware
+template <typename Coefs, int M = 0, bool Zero = (M < Coefs::taps && Coefs::val[M] == 0)>
+struct firFirstTap { enum { val = firFirstTap<Coefs, M + 1>::val }; };
+template <typename Coefs, int M>
+struct firFirstTap<Coefs, M, false> { enum { val = M }; };
+
+template <typename Coefs, int M = Coefs::taps - 1, bool Zero = (M >= 0 && Coefs::val[M] == 0)>
+struct firLastTap { enum { val = firLastTap<Coefs, M - 1>::val }; };
+template <typename Coefs, int M>
+struct firLastTap<Coefs, M, false> { enum { val = M }; };
+
+// Sum of Coefs::val[m]*window[m - Lo] for taps m = M..End-1, empty
+// once M reaches End (or starts past it)
+template <typename Coefs, int Lo, int M, int End, bool Done = (M >= End)>
+struct firConstTaps {
+  enum { adders = csdMul<Coefs::val[M]>::adders + firConstTaps<Coefs, Lo, M + 1, End>::adders };
+
+  template <typename AccT, typename SampleT>
+  static AccT sum(const SampleT window[])
+  {
+    AccT acc = firConstTaps<Coefs, Lo, M + 1, End>::template sum<AccT>(window);
+    acc += csdMul<Coefs::val[M]>::mul(AccT(window[M - Lo]));
+    return acc;
+  }
+};
+
+template <typename Coefs, int Lo, int M, int End>
+struct firConstTaps<Coefs, Lo, M, End, true> {
+  enum { adders = 0 };
+
+  template <typename AccT, typename SampleT>
+  static AccT sum(const SampleT window[])
+  {
+    return 0;
+  }
+};
+
+// Taylor series of cos x and sin x from term k on, summed from the small
+// end; constexpr so the FFT twiddles are built by the compiler
+constexpr double firCosTerms(double x, double term, int k)
+{
+  return k == 24 ? 0 : term + firCosTerms(x, -term*x*x/((2*k + 1)*(2*k + 2)), k + 1);
+}
+
+constexpr double firSinTerms(double x, double term, int k)
+{
+  return k == 24 ? 0 : term + firSinTerms(x, -term*x*x/((2*k + 2)*(2*k + 3)), k + 1);
+}
+
+// Nearest integer to v*2^frac
+constexpr long long firFixed(double v, int frac)
+{
+  return v < 0 ? -(long long)(-v*(1LL << frac) + 0.5) : (long long)(v*(1LL << frac) + 0.5);
+}
+
+// Real and imaginary part of exp(-2*pi*i*t/len) with frac fraction bits,
+// for 0 <= t < len/2; angles past pi/2 are mirrored to keep the series short
+constexpr long long firTwiddleRe(int t, int len, int frac)
+{
+  return 4*t > len ? -firTwiddleRe(len/2 - t, len, frac)
+                   : firFixed(firCosTerms(6.283185307179586477*t/len, 1.0, 0), frac);
+}
+
+constexpr long long firTwiddleIm(int t, int len, int frac)
+{
+  return 4*t > len ? firTwiddleIm(len/2 - t, len, frac)
+                   : -firFixed(firSinTerms(6.283185307179586477*t/len, 6.283185307179586477*t/len, 0), frac);
+}
+
+// Indices 0..N-1 as a parameter pack, built by halves
+template <int... I> struct firSeq {};
+template <typename A, typename B> struct firCatSeq;
+template <int... I, int... J>
+struct firCatSeq<firSeq<I...>, firSeq<J...> > { typedef firSeq<I..., (int)sizeof...(I) + J...> type; };
+template <int N> struct firMakeSeq {
+  typedef typename firCatSeq<typename firMakeSeq<N/2>::type, typename firMakeSeq<N - N/2>::type>::type type;
+};
+template <> struct firMakeSeq<0> { typedef firSeq<> type; };
+template <> struct firMakeSeq<1> { typedef firSeq<0> type; };
+
+// Twiddle ROM of a Len point transform, Len/2 entries
+template <int Len, int Frac, typename Seq = typename firMakeSeq<Len/2>::type>
+struct firTwiddles;
+
+template <int Len, int Frac, int... T>
+struct firTwiddles<Len, Frac, firSeq<T...> > {
+  static constexpr long long re[Len/2] = { firTwiddleRe(T, Len, Frac)... };
+  static constexpr long long im[Len/2] = { firTwiddleIm(T, Len, Frac)... };
+};
+
+template <int Len, int Frac, int... T>
+constexpr long long firTwiddles<Len, Frac, firSeq<T...> >::re[Len/2];
+template <int Len, int Frac, int... T>
+constexpr long long firTwiddles<Len, Frac, firSeq<T...> >::im[Len/2];
+
+/**
+ * FIR filter unit with a memory-mapped register interface.
+ *
+ * Taps     number of filter coefficients
+ * Block    number of new samples consumed (and outputs produced) per start
+ * SampleT  sample and coefficient type (sc_int<W>), e.g. sc_int<8> packs
+ *          eight samples to a register
+ * AccT     accumulator type
+ * Lanes    number of parallel MAC lanes in the block datapath
+ * CoefSets number of coefficient sets held on chip
+ * Channels number of channel contexts (history, set and phase)
+ * OutBits  width of block outputs, 0 = sample width
+ * FftTaps  jobs with at least this many taps use the FFT engine, 0 = no
+ *          FFT engine
+ * ConstCoefs coefficient table fixed at build time (see firNoCoefs), or
+ *          firNoCoefs for loadable coefficients
+ *
+ * Samples and coefficients are packed DATA_WIDTH/W to a register, lowest
+ * sample in the least significant bits, and block outputs DATA_WIDTH/
+ * outWidth to a register.  An output is the accumulator shifted right by
+ * cfgReg[29:24], then cut to outWidth bits, or clamped to its range when
+ * cfgReg[30] is set.  The register map is derived from
+ * the parameters (16 taps, 16 samples, 16 bit gives the original map):
+ *
+ *   0                   status: [1:0] = 3 when a block is done,
+ *                       [4] = bank of the block,
+ *                       [5] = threshold crossed (post-processing),
+ *                       [23:8] = outputs of a resampling block,
+ *                       0 for any other command
+ *   1                   control, see below
+ *   coefReg..           coefficients, numCoefReg registers
+ *   inReg..             bank 0 input samples, numBlockReg registers
+ *   outReg..            bank 0 filtered outputs, numOutReg registers
+ *   inReg1..            bank 1 input samples, numBlockReg registers
+ *   outReg1..           bank 1 filtered outputs, numOutReg registers
+ *   srcAddrReg          bus-master job: input buffer address
+ *   dstAddrReg          bus-master job: output buffer address
+ *   lenReg              bus-master job: number of samples
+ *   ringBaseReg         descriptor ring: address of descriptor 0
+ *   ringSizeReg         descriptor ring: number of descriptors
+ *   ringTailReg         descriptor ring: producer index (software)
+ *   ringDoneReg         descriptor ring: completion index (hardware)
+ *   cfgReg              [7:0] taps used by register, bus-master and
+ *                       ring jobs, 0 = Taps
+ *                       [15:8] decimation factor M, 0 or 1 = off
+ *                       [23:16] interpolation factor L, 0 or 1 = off
+ *                       [29:24] output shift
+ *                       [30] saturate outputs
+ *                       [31] complex I/Q samples
+ *                       [32] complex coefficients
+ *                       [33] post-processing
+ *   ctxAddrReg          context save/restore address
+ *   bankSetsReg         filter-bank job: number of sets, 0 = CoefSets
+ *   bankStrideReg       filter-bank job: bytes between the set outputs
+ *   threshReg           post-processing: |y| threshold, 0 = off
+ *   energyReg           post-processing: sum of y*y over the job
+ *   peakReg             post-processing: [31:0] max |y|, [47:32] its
+ *                       output index (65535 for any later index),
+ *                       [48] = max |y| >= threshold
+ *   jobCountReg         blocks, bus-master jobs and descriptors done
+ *                       (read only)
+ *   sampleCountReg      input samples filtered by those jobs (read only)
+ *   busyCountReg        clocks with a command running (read only)
+ *   idleCountReg        clocks without one (read only)
+ *   stallCountReg       clocks a result write waited for the slave
+ *                       (read only)
+ *   rdBeatCountReg      AXI read beats served by the slave (read only)
+ *   wrBeatCountReg      AXI write beats served by the slave (read only)
+ *
+ * The control register is acted on whenever it changes:
+ *
+ *   [3:0]  command, 2 = start a block from the register bank,
+ *          4 = start a bus-master job,
+ *          5 = run the descriptor ring,
+ *          6 = load the coefficient registers into a set,
+ *          7 = save the channel context to ctxAddrReg,
+ *          8 = restore the channel context from ctxAddrReg,
+ *          9 = start a filter-bank job
+ *   [4]    linear phase: coefficients are symmetric, so mirrored input
+ *          pairs are added before multiplying (half the MAC cycles)
+ *   [5]    bank: input and output registers used by the block
+ *   [6]    stored coefficients: run with coefficient set [11:8] as held
+ *          on chip; when clear the coefficient registers are first
+ *          copied into set [11:8]
+ *   [7]    channel set: use the coefficient set bound to the channel
+ *          instead of [11:8]
+ *   [11:8] coefficient set; also bound to the channel when [7] is clear
+ *   [23:16] channel
+ *
+ * The coefficient registers are a shadow of the on-chip sets: they are
+ * only copied at a start (or by command 6, which copies them into set
+ * [11:8] without filtering), so software can write the next filter while
+ * a job runs.  Once the sets are loaded, switching filters costs no
+ * coefficient transfers.
+ *
+ * The two banks let software fill the next inputs and drain the previous
+ * outputs while a block is computed.  Alternating the bank bit also makes
+ * every start a control register change, so no re-arm write is needed.
+ *
+ * A bus-master job reads the input buffer over axi_mst_read one block
+ * (numBlockReg beats) per burst, filters it and writes the block to the
+ * output buffer over axi_mst_write, so a whole signal is filtered with one
+ * control write.  If the length is not a multiple of the block, the last
+ * block is shorter: only the remaining samples are read and only their
+ * outputs written, the last beat strobing just the bytes they occupy.
+ *
+ * A filter-bank job (command 9) is a bus-master job that applies sets
+ * 0..bankSetsReg-1 to every input block before moving on, writing the
+ * output of set s to dstAddrReg + s*bankStrideReg.  Each input block is
+ * read once and shares one history, so an N-way channelizer costs one
+ * input stream instead of N.
+ *
+ * While the command is 5 the unit works through the descriptor ring in
+ * memory, from ringDoneReg up to ringTailReg, as bus-master jobs.  Each
+ * descriptor is descWords 64 bit words:
+ *
+ *   [0] input address  [1] output address  [2] samples  [3] coefficient set
+ *
+ * ringDoneReg is advanced after each descriptor, and software queues more
+ * work by advancing ringTailReg, so a batch costs one register write.
+ * Each descriptor runs with the stored coefficient set it names.  Word
+ * [3] is laid out as [3:0] set, [7] channel set, [23:16] channel, with
+ * the same meaning as in the control register.
+ *
+ * Each of the Channels contexts keeps its own input history, coefficient
+ * set and resampling phase, so blocks of different low-rate signals can be
+ * interleaved on one datapath and each channel continues where it left
+ * off without software saving its history.
+ *
+ * For more streams than Channels, commands 7 and 8 move the context of
+ * channel [23:16] to or from memory at ctxAddrReg in one burst of
+ * ctxWords 64 bit words:
+ *
+ *   [0] [15:0] phaseQ, [31:16] phaseR, [35:32] coefficient set,
+ *       [63:40] cfgReg[23:0] the phase was computed with
+ *   [1..] the last Taps-1 input samples, oldest first, packed like inputs
+ *
+ * so a scheduler can swap streams in and out at the cost of one burst
+ * each way.  A restored channel continues from the saved phase when it
+ * runs with the saved taps and rate factors, however cfgReg was written
+ * in between.
+ *
+ * A filter shorter than Taps is run by setting cfgReg: it uses the first
+ * taps coefficients of the set and the MAC pass ends after those, so the
+ * block (and its done status) takes proportionally fewer clocks.
+ *
+ * Loading a set also builds the list of its nonzero coefficients.  With
+ * one MAC lane the pass steps through that list only, so a block takes
+ * one clock per output and nonzero tap and the zeros of a windowed or
+ * pruned filter cost nothing.  With more lanes the pass runs from the
+ * first to the last nonzero tap, so the zero ends cost no cycles, but
+ * zero taps between them still take their clock, with the multiply gated
+ * off, so that the shared input window keeps shifting by one sample per
+ * clock.
+ *
+ * With a decimation or interpolation factor set, a block is filtered as
+ * a polyphase resampler by L/M.  A block reads Block/L new inputs, which
+ * span Block output-rate positions, and only every M-th of those is
+ * computed.  For each such output only the taps that land on real
+ * (not zero-stuffed) inputs are applied, about taps/L of them, so a block
+ * costs about Block/M outputs of taps/L MACs.  The outputs are packed from
+ * the start of the output registers and their count is in status[23:8].
+ * The decimation phase of a channel carries over from block to block and
+ * restarts when the channel is run with other taps or rate factors
+ * (cfgReg[23:0]), so interleaved channels at different rates each keep
+ * their own phase.  Linear-phase mode is not used while resampling.
+ * Bus-master jobs need Block/L to be a multiple of samplesPerReg, and
+ * their output is contiguous when every block yields a multiple of
+ * outsPerReg outputs.
+ *
+ * In complex mode consecutive samples are I/Q pairs (I in the lower
+ * half, so a 32 bit lane of a register holds one 16 bit complex sample)
+ * and a block is Block/2 complex samples in and out, with Block even.
+ * Real coefficient sets scale I and Q alike; with complex coefficients a
+ * set holds interleaved re/im pairs and each step is a full complex
+ * multiply-accumulate.  Either way a filter has up to Taps/2 complex taps
+ * (cfgReg[7:0] counts complex taps) and is done in one pass, without
+ * linear-phase or resampling.
+ *
+ * With post-processing on, register and bus-master jobs also fold every
+ * output (as written, after shift and saturation) into the energy, peak
+ * and threshold results, which are written before the status.  A block
+ * that needs no further attention is then recognised from peakReg alone
+ * instead of draining the output registers.  Ring and filter-bank jobs
+ * ignore cfgReg[33], as they have no single set of results to report.
+ *
+ * The count registers run freely from reset, so software measures a
+ * stretch of work by differencing two reads; the job and sample counts
+ * are written before the status of each command and after each ring
+ * descriptor.  All seven ignore software writes; the last five are kept
+ * by the slave itself.  A ring waiting for descriptors counts as idle.
+ * The streaming path is not counted.
+ *
+ * Besides the register interface, sampleIn/sampleOut form a streaming
+ * path that produces one filtered sample per clock once the pipeline has
+ * filled.  It uses the same coefficient registers but keeps its own
+ * history, so streaming and register jobs do not disturb each other.
+ * It applies the first cfgReg[7:0] taps and scales its outputs by the
+ * cfgReg shift and saturation like block outputs, to the sample width.
+ * With a decimation factor in cfgReg[15:8] only every M-th output is
+ * sent, so units can be chained sampleOut to sampleIn into a multi-stage
+ * decimator (see TlmToAxi) that rescales at every stage.  The stage
+ * settings are decoded when cfgReg changes, which also restarts the
+ * decimation phase.
+ *
+ * With FftTaps set, real jobs at the full rate with at least FftTaps taps
+ * are filtered by fast convolution instead of the MAC array.  A block is
+ * filtered by overlap-save over the fftLen = histLen samples of its
+ * channel history: the window and the coefficient set are transformed,
+ * multiplied bin by bin and transformed back, and the last Block results
+ * are the outputs.  The spectrum of a set is kept and only recomputed
+ * after the set is loaded or run with another tap count.  A block costs
+ * two transforms of fftLen/2*fftBits butterflies, one per clock, instead
+ * of Block*taps MACs, which pays off for long filters with Block of the
+ * order of Taps (e.g. 256 taps and a 256 sample block).  The
+ * transforms are fixed point with fftGuard fraction bits on the data and
+ * fftTwFrac on the twiddles (a ROM built at compile time, firTwiddles),
+ * sized to keep every accumulator within 1 of the direct form (before
+ * the output shift).  rocket_sim/variants.sh checks that fir.c still
+ * reproduces expected.inc exactly with FIR_FFT_TAPS=16.
+ *
+ * With a ConstCoefs table (Taps entries) real jobs at the full rate are
+ * filtered with that table instead of a loaded set, whatever the set and
+ * tap count of the job.  Each coefficient is a constant, so its multiply
+ * becomes a canonical signed digit shift-add network (csdMul), and the
+ * zero taps at both ends of the table are dropped.  All taps of one
+ * output are evaluated together, one output per clock, and the results
+ * are meant to be bit-identical to the multiplier datapath with the same
+ * table loaded; rocket_sim/variants.sh checks fir.c against expected.inc
+ * with FIR_CONST_COEFS=1.  Resampling and complex jobs still use the
+ * loaded sets.  The table needs at least one nonzero tap.
+ */
+template <int Taps, int Block, typename SampleT = sc_int<16>, typename AccT = sc_int<32>, int Lanes = 1, int CoefSets = 1, int Channels = 1, int OutBits = 0, int FftTaps = 0, typename ConstCoefs = firNoCoefs>
 class firUnit : public sc_module {
  public:
   static const int kDebugLevel = 4;
+  // cycle reports, above the default verbosity so they appear only when
+  // asked for
+  static const int kPerfDebugLevel = 3;
 
   typedef axi::axi4<axi::cfg::standard> axi_;
-  enum { numReg = 14, baseAddress = 0x0, numAddrBitsToInspect = 16 };
+  typedef NVUINTW(axi_::DATA_WIDTH) reg_t;
+
+  enum {
+    sampleWidth = firTypeWidth<SampleT>::val,
+    accWidth = firTypeWidth<AccT>::val,
+    samplesPerReg = axi_::DATA_WIDTH / sampleWidth,
+    bytesPerReg = axi_::DATA_WIDTH / 8,
+    numCoefReg = (Taps + samplesPerReg - 1) / samplesPerReg,
+    numBlockReg = (Block + samplesPerReg - 1) / samplesPerReg,
+    outWidth = OutBits ? OutBits : sampleWidth,
+    outsPerReg = axi_::DATA_WIDTH / outWidth,
+    numOutReg = (Block + outsPerReg - 1) / outsPerReg,
+    statusReg = 0,
+    ctrlReg = 1,
+    coefReg = 2,
+    inReg = coefReg + numCoefReg,
+    outReg = inReg + numBlockReg,
+    inReg1 = outReg + numOutReg,
+    outReg1 = inReg1 + numBlockReg,
+    srcAddrReg = outReg1 + numOutReg,
+    dstAddrReg = srcAddrReg + 1,
+    lenReg = dstAddrReg + 1,
+    ringBaseReg = lenReg + 1,
+    ringSizeReg = ringBaseReg + 1,
+    ringTailReg = ringSizeReg + 1,
+    ringDoneReg = ringTailReg + 1,
+    cfgReg = ringDoneReg + 1,
+    ctxAddrReg = cfgReg + 1,
+    bankSetsReg = ctxAddrReg + 1,
+    bankStrideReg = bankSetsReg + 1,
+    threshReg = bankStrideReg + 1,
+    energyReg = threshReg + 1,
+    peakReg = energyReg + 1,
+    jobCountReg = peakReg + 1,
+    sampleCountReg = jobCountReg + 1,
+    numReg = sampleCountReg + 1,
+    // counters kept by the slave, mapped after the registers
+    busyCountReg = numReg,
+    idleCountReg = busyCountReg + 1,
+    stallCountReg = idleCountReg + 1,
+    rdBeatCountReg = stallCountReg + 1,
+    wrBeatCountReg = rdBeatCountReg + 1,
+    numMappedReg = wrBeatCountReg + 1,
+    descWords = 4,
+    // control register fields
+    ctrlCmdWidth = 4,
+    cmdStart = 0x2,
+    cmdMaster = 0x4,
+    cmdRing = 0x5,
+    cmdLoadCoef = 0x6,
+    cmdSave = 0x7,
+    cmdRestore = 0x8,
+    cmdBank = 0x9,
+    ctrlSymBit = 4,
+    ctrlBankBit = 5,
+    ctrlStoredBit = 6,
+    ctrlChanSetBit = 7,
+    ctrlSetLsb = 8,
+    ctrlSetWidth = 4,
+    ctrlChanLsb = 16,
+    ctrlChanWidth = 8,
+    // descriptor word 3 fields
+    descSetLsb = 0,
+    // saved context: header word, then the history
+    ctxPhaseQLsb = 0,
+    ctxPhaseRLsb = 16,
+    ctxPhaseWidth = 16,
+    ctxSetLsb = 32,
+    ctxPhaseCfgLsb = 40,
+    ctxHistLen = Taps - 1,
+    ctxHistRegs = (ctxHistLen + samplesPerReg - 1) / samplesPerReg,
+    ctxWords = 1 + ctxHistRegs,
+    // cfg register fields
+    cfgTapsLsb = 0,
+    cfgTapsWidth = 8,
+    cfgDecimLsb = 8,
+    cfgInterpLsb = 16,
+    cfgRateWidth = 8,
+    // taps and rate factors, on which the resampling phase depends
+    cfgPhaseWidth = cfgInterpLsb + cfgRateWidth,
+    cfgShiftLsb = 24,
+    cfgShiftWidth = 6,
+    cfgSatBit = 30,
+    cfgCplxBit = 31,
+    cfgCplxCoefBit = 32,
+    cfgStatsBit = 33,
+    // status register fields
+    statusDone = 0x3,
+    statusBankBit = 4,
+    statusThreshBit = 5,
+    // peak register fields
+    peakMagWidth = 32,
+    peakIndexLsb = 32,
+    peakIndexWidth = 16,
+    peakThreshBit = 48,
+    statusCountLsb = 8,
+    // circular history: the last Taps-1 samples plus the new block
+    histBits = nvhls::log2_ceil<Taps - 1 + Block>::val,
+    histLen = 1 << histBits,
+    // clocks spent in the MAC array per block at the full tap count
+    macCycles = (Block + Lanes - 1) / Lanes * Taps,
+    symMacCycles = (Block + Lanes - 1) / Lanes * ((Taps + 1) / 2),
+    // FFT engine: one transform spans the whole circular history
+    fftBits = histBits,
+    fftLen = histLen,
+    fftGuard = sampleWidth + (fftBits + 1)/2,
+    fftTwFrac = sampleWidth + fftGuard,
+    fftTwWidth = fftTwFrac + 2,
+    fftWidth = 2*sampleWidth + 2*fftBits + fftGuard,
+    fftCycles = 2*(fftLen/2*fftBits) + 2*fftLen,
+    // engine storage, collapsed when there is no FFT engine
+    fftSets = FftTaps ? CoefSets : 1,
+    fftMem = FftTaps ? fftLen : 2,
+    // constant-coefficient network: taps constFirst..constLast
+    constFirst = (int)firFirstTap<ConstCoefs>::val,
+    constLast = (int)firLastTap<ConstCoefs>::val,
+    constSpan = constLast >= constFirst ? constLast - constFirst + 1 : 1,
+    constAdders = firConstTaps<ConstCoefs, constFirst, constFirst, constLast + 1>::adders
+  };
+  enum { baseAddress = 0x0, numAddrBitsToInspect = 16 };
+
+  // Settings of one job, decoded from the control and cfg registers
+  struct job_t {
+    bool sym;
+    int chan;
+    int set;
+    int taps;
+    int shift;
+    bool sat;
+    bool cplx;
+    bool cplxCoef;
+    bool stats;
+    int decim;    // M
+    int interp;   // L
+    int inCount;  // new inputs per block, Block/L
+    // (taps-1) = tapsQ*L + tapsR and M = decimQ*L + decimR, so the
+    // polyphase datapath steps through positions without dividing
+    int tapsQ, tapsR;
+    int decimQ, decimR;
+    int tapsPerPhase;
+    int phaseCfg; // cfgReg[cfgPhaseWidth-1:0]
+  };
+
+  static_assert(axi_::DATA_WIDTH % sampleWidth == 0, "Sample width must divide the AXI data width");
+  static_assert(accWidth >= sampleWidth, "Accumulator must be at least as wide as a sample");
+  static_assert(axi_::DATA_WIDTH % outWidth == 0 && outWidth <= accWidth, "Output width must divide the AXI data width and fit the accumulator");
+  static_assert(Lanes >= 1, "At least one MAC lane is required");
+  static_assert(CoefSets >= 1 && CoefSets <= (1 << ctrlSetWidth), "Coefficient sets must fit the control set field");
+  static_assert(Channels >= 1 && Channels <= (1 << ctrlChanWidth), "Channels must fit the control channel field");
+  static_assert(ctxPhaseCfgLsb + cfgPhaseWidth <= axi_::DATA_WIDTH, "The context header must fit one word");
+  static_assert(numMappedReg * bytesPerReg <= (1 << numAddrBitsToInspect), "Register map exceeds the slave address space");
+  static_assert(FftTaps >= 0 && FftTaps <= Taps, "The FFT threshold must be a tap count");
+  static_assert(fftTwWidth >= fftGuard, "Twiddle products must hold a bin product");
+  static_assert(ConstCoefs::taps == 0 || ConstCoefs::taps == Taps, "A constant coefficient table must have Taps entries");
+  static_assert(ConstCoefs::taps == 0 || constLast >= constFirst, "A constant coefficient table needs a nonzero tap");
 
   sc_in<bool> clk;
   sc_in<bool> reset_bar;
@@ -49,25 +580,88 @@ class firUnit : public sc_module {
   typename axi_::read::template slave<> axi_read;
   typename axi_::write::template slave<> axi_write;
 
-  AxiSlaveToReg2<axi::cfg::standard, numReg, numAddrBitsToInspect> slave;
-  typedef AxiSlaveToReg2<axi::cfg::standard, numReg, numAddrBitsToInspect>::reg_write reg_write_;
+  // Bus-master port used by bus-master jobs to fetch inputs and store results
+  typename axi_::read::template master<> axi_mst_read;
+  typename axi_::write::template master<> axi_mst_write;
+
+  // the job and sample counts end the register bank and are read only
+  AxiSlaveToReg2<axi::cfg::standard, numReg, numAddrBitsToInspect, true, numReg - jobCountReg> slave;
+  typedef AxiSlaveToReg2<axi::cfg::standard, numReg, numAddrBitsToInspect, true, numReg - jobCountReg> slave_t;
+  typedef typename slave_t::reg_write reg_write_;
+  static_assert(busyCountReg - numReg == slave_t::perfBusy && idleCountReg - numReg == slave_t::perfIdle
+                && stallCountReg - numReg == slave_t::perfStall && rdBeatCountReg - numReg == slave_t::perfRdBeat
+                && wrBeatCountReg - numReg == slave_t::perfWrBeat && numMappedReg - numReg == slave_t::numPerfReg,
+                "Counter registers must follow the slave counter order");
 
   sc_signal<NVUINTW(numAddrBitsToInspect)> baseAddr;
-  sc_signal<NVUINTW(axi_::DATA_WIDTH)> regOut_chan[numReg];
+  sc_signal<reg_t> regOut_chan[numReg];
+
+  // A command is running, for the slave's busy and idle counters
+  sc_signal<bool> busy_chan;
+
+  // Result writes into the slave; a push blocks until the slave takes it
+  Connections::Out<reg_write_> regWrite;
+  Connections::Combinational<reg_write_> regIn_chan;
 
-  Connections::CombinationalBufferedPorts<reg_write_,0,1> regIn_chan;
+  // Streaming sample path, one raw sample per transfer
+  typedef NVUINTW(sampleWidth) stream_t;
+  Connections::In<stream_t> sampleIn;
+  Connections::Out<stream_t> sampleOut;
 
-  //array to store weights in continuous block
-  //HLS will optimize this out ideally
-  sc_int<16> weights[16];
+  //coefficient sets, one selected per job
+  SampleT weights[CoefSets][Taps];
 
-  //array to hold copies of last 16 inputs and new 16 inputs
-  //HLS should pipeline this and not cache everything
-  sc_int<16> inputBuffer[32];
+  //first and last nonzero weight of each set, found when the set is
+  //loaded (first > last for an all-zero set); every tap after reset
+  int tapFirst[CoefSets];
+  int tapLast[CoefSets];
 
-  //Array for storing output of FIR calculation
-  //sc_int not compatible with bit masking & shifting, so used short
-  short outputArray[32];
+  //ascending indices of the nonzero weights of each set, and their number
+  int tapList[CoefSets][Taps];
+  int tapCount[CoefSets];
+
+  //per channel circular buffer of past and new inputs; new samples are
+  //written at histHead, which then moves forward by the block, so nothing
+  //is shifted
+  SampleT inputBuffer[Channels][histLen];
+  NVUINTW(histBits) histHead[Channels];
+
+  //per channel next output-rate position to compute, relative to the
+  //block start, as phaseQ*L + phaseR
+  int phaseQ[Channels];
+  int phaseR[Channels];
+
+  //per channel taps and rate factors the phase was computed with
+  int chanPhaseCfg[Channels];
+
+  //coefficient set bound to each channel
+  int chanSet[Channels];
+
+  //Array for storing output of FIR calculation, one per new sample
+  AccT outputArray[Block];
+
+  //FFT engine: spectrum of each set with the tap count it was made for
+  //(0 = stale) and a work buffer; the twiddles exp(-2*pi*i*t/fftLen) are
+  //a constant ROM
+  typedef NVINTW(fftWidth) fft_t;
+  typedef NVINTW(fftTwWidth) fftTw_t;
+  typedef NVINTW(fftWidth + fftTwWidth) fftWide_t;
+  fft_t coefSpecRe[fftSets][fftMem];
+  fft_t coefSpecIm[fftSets][fftMem];
+  int coefSpecTaps[fftSets];
+  fft_t fftRe[fftMem];
+  fft_t fftIm[fftMem];
+  typedef firTwiddles<fftMem, fftTwFrac> twiddles;
+
+  //post-processing results of the current job
+  reg_t statEnergy;
+  NVUINTW(peakMagWidth) statPeak;
+  int statIndex;
+  int statCount;
+
+  //free-running job and input sample counts
+  reg_t jobCount;
+  reg_t sampleCount;
 
   SC_HAS_PROCESS(firUnit);
 
@@ -77,8 +671,13 @@ class firUnit : public sc_module {
         reset_bar("reset_bar"),
         axi_read("axi_read"),
         axi_write("axi_write"),
+        axi_mst_read("axi_mst_read"),
+        axi_mst_write("axi_mst_write"),
         slave("slave"),
-        regIn_chan("regIn_chan")
+        regWrite("regWrite"),
+        regIn_chan("regIn_chan"),
+        sampleIn("sampleIn"),
+        sampleOut("sampleOut")
   {
     slave.clk(clk);
     slave.reset_bar(reset_bar);
@@ -86,126 +685,1113 @@ class firUnit : public sc_module {
     slave.if_axi_rd(axi_read);
     slave.if_axi_wr(axi_write);
     slave.regIn(regIn_chan);
+    regWrite(regIn_chan);
 
     slave.baseAddr(baseAddr);
     baseAddr.write(baseAddress);
+    slave.busy(busy_chan);
 
     for (int i = 0; i < numReg; i++) {
       slave.regOut[i](regOut_chan[i]);
     }
 
     //initialize all buffers to zero
-    for (int i = 0; i < 16; i++) {
-      weights[i] = 0;
-    } 
+    for (int s = 0; s < CoefSets; s++) {
+      for (int i = 0; i < Taps; i++) {
+        weights[s][i] = 0;
+      }
+    }
 
-    for (int i = 0; i < 32; i++) {
-      inputBuffer[i] = 0;
-    } 
+    for (int c = 0; c < Channels; c++) {
+      for (int i = 0; i < histLen; i++) {
+        inputBuffer[c][i] = 0;
+      }
+    }
 
-    SC_THREAD (run); 
-    sensitive << clk.pos(); 
+    SC_THREAD (run);
+    sensitive << clk.pos();
+    NVHLS_NEG_RESET_SIGNAL_IS(reset_bar);
+
+    SC_THREAD (runStream);
+    sensitive << clk.pos();
     NVHLS_NEG_RESET_SIGNAL_IS(reset_bar);
   }
 
-  void run()
+  // Raw sample bits sign-extended into SampleT
+  static SampleT toSample(const stream_t &bits)
+  {
+    return SampleT(bits.to_int64());
+  }
+
+  // Accumulator truncated to the sample width
+  static stream_t toBits(const AccT &val)
+  {
+    return stream_t((long long)val);
+  }
+
+  // Sample `lane` of a packed register
+  static SampleT unpackSample(const reg_t &word, int lane)
+  {
+    return toSample(nvhls::get_slc<sampleWidth>(word, lane*sampleWidth));
+  }
+
+  // Accumulator scaled to an output: shifted, then saturated or wrapped
+  // to the output width
+  template <int W = outWidth>
+  static long long scaleOutput(const AccT &val, const job_t &job)
+  {
+    const long long maxOut = (1LL << (W - 1)) - 1;
+    long long out = (long long)val >> job.shift;
+    if (job.sat) {
+      if (out > maxOut) out = maxOut;
+      if (out < -maxOut - 1) out = -maxOut - 1;
+    }
+    return NVINTW(W)(out).to_int64();
+  }
+
+  // Scale an accumulator to an output and place it in `lane`
+  static void packOutput(reg_t &word, int lane, const AccT &val, const job_t &job)
+  {
+    word = nvhls::set_slc(word, NVUINTW(outWidth)(scaleOutput(val, job)), lane*outWidth);
+  }
+
+  // History sample at offset p from the first sample of the current
+  // block; p = -1 is the newest sample of the previous block
+  SampleT bufferAt(int chan, int p)
+  {
+    return inputBuffer[chan][(histHead[chan].to_int() + p) & (histLen - 1)];
+  }
+
+#ifndef __SYNTHESIS__
+  // Clock periods from t to now, for the performance messages
+  double clocksSince(const sc_time &t)
+  {
+    sc_clock *c = dynamic_cast<sc_clock *>(clk.get_interface());
+    return c ? (sc_time_stamp() - t)/c->period() : 0;
+  }
+#endif
+
+  // Single-lane MAC pass over the list of the set's nonzero taps.  One
+  // lane gains nothing from a shifting window, so it reads the input of
+  // each listed tap m, x[n-taps+1+m] (plus the mirror x[n-m] in
+  // linear-phase mode), straight from the history, and an output costs
+  // one clock per nonzero tap below taps (or up to the centre tap).
+  void computeListBlock(const job_t &job)
+  {
+    const bool sym = job.sym;
+    const int taps = job.taps;
+    const int steps = sym ? (taps + 1)/2 : taps;
+    const bool oddCentre = sym && (taps % 2 == 1);
+    int nz = 0;
+#ifndef __SYNTHESIS__
+    const sc_time start = sc_time_stamp();
+#endif
+
+    for (int n = 0; n < Block; n++) {
+      AccT acc = 0;
+      nz = 0;
+      for (int s = 0; s < Taps; s++) {
+        if (s == tapCount[job.set]) break;
+        const int m = tapList[job.set][s];
+        if (m >= steps) break;
+        bool pair = sym && !(oddCentre && m == steps - 1);
+        AccT x = bufferAt(job.chan, n - taps + 1 + m);
+        if (pair) x += bufferAt(job.chan, n - m);
+        acc += weights[job.set][m]*x;
+        nz++;
+        wait();
+      }
+      outputArray[n] = acc;
+    }
+    CDCOUT(sc_time_stamp() << " " << name() << " FIR block: " << dec << taps << " taps (" << nz
+                  << " nonzero steps) x " << Block << " outputs in " << clocksSince(start)
+                  << " cycles (tap list" << (sym ? ", linear phase" : "") << ")" << endl, kPerfDebugLevel);
+  }
+
+  // Output-stationary systolic MAC array, used with more than one lane.
+  // Each lane owns one output and each clock every lane does one
+  // multiply-accumulate with the broadcast weight, then the input window
+  // shifts one lane down, so only one new sample is read from
+  // inputBuffer per clock.  A pass produces Lanes
+  // outputs and runs from the first to the last nonzero tap of the set;
+  // zero taps in between keep their clock (the window still shifts) but
+  // the multiply is gated off.  Only the Block new outputs are computed.
+  //
+  // In linear-phase mode tap m is applied to the pre-added pair
+  // x[n-taps+1+m] + x[n-m], held in a second window that shifts the other
+  // way, so a pass takes at most (taps+1)/2 clocks.  The centre tap of an
+  // odd filter is applied once.
+  //
+  // A job with fewer taps stops at tap taps-1 (or the centre tap); any
+  // zero taps before that are gated like the others.
+  void computeBlock(const job_t &job)
+  {
+    const bool sym = job.sym;
+    const int taps = job.taps;
+    const int steps = sym ? (taps + 1)/2 : taps;
+    const bool oddCentre = sym && (taps % 2 == 1);
+    const int first = tapFirst[job.set];
+    const int last = tapLast[job.set] < steps ? tapLast[job.set] : steps - 1;
+#ifndef __SYNTHESIS__
+    const sc_time start = sc_time_stamp();
+#endif
+
+    for (int n0 = 0; n0 < Block; n0 += Lanes) {
+      AccT acc[Lanes];
+      SampleT window[Lanes];
+      SampleT mirror[Lanes];
+#pragma hls_unroll yes
+      for (int l = 0; l < Lanes; l++) {
+        acc[l] = 0;
+        window[l] = bufferAt(job.chan, n0 + l - taps + 1 + first);
+        mirror[l] = bufferAt(job.chan, n0 + l - first);
+      }
+
+      for (int s = 0; s < Taps; s++) {
+        const int m = first + s;
+        if (m > last) break;
+        bool pair = sym && !(oddCentre && m == steps - 1);
+        SampleT w = weights[job.set][m];
+        if (w != 0) {
+#pragma hls_unroll yes
+          for (int l = 0; l < Lanes; l++) {
+            AccT x = window[l];
+            if (pair) x += mirror[l];
+            acc[l] += w*x;
+          }
+        }
+#pragma hls_unroll yes
+        for (int l = 0; l < Lanes - 1; l++) {
+          window[l] = window[l + 1];
+        }
+        window[Lanes - 1] = bufferAt(job.chan, n0 + Lanes + m - taps + 1);
+#pragma hls_unroll yes
+        for (int l = Lanes - 1; l > 0; l--) {
+          mirror[l] = mirror[l - 1];
+        }
+        mirror[0] = bufferAt(job.chan, n0 - m - 1);
+        wait();
+      }
+
+#pragma hls_unroll yes
+      for (int l = 0; l < Lanes; l++) {
+        if (n0 + l < Block) {
+          outputArray[n0 + l] = acc[l];
+        }
+      }
+    }
+    CDCOUT(sc_time_stamp() << " " << name() << " FIR block: " << dec << taps << " taps ("
+                  << (last >= first ? last - first + 1 : 0) << " steps from tap " << first << ") x "
+                  << Block << " outputs in " << clocksSince(start)
+                  << " cycles (" << Lanes << " MAC lanes" << (sym ? ", linear phase" : "") << ")" << endl, kPerfDebugLevel);
+  }
+
+  // Polyphase resampler.  Each lane takes the next output position k to
+  // compute; tap m of it applies to input (k-taps+1+m)/L when that is a
+  // whole number, so the lane starts at the first such tap and steps by L
+  // taps and one input.  Positions and phases are carried as quotient and
+  // remainder of L.  Returns the number of outputs.
+  int computePolyphase(const job_t &job)
+  {
+    const int L = job.interp;
+    int kq = phaseQ[job.chan];
+    int kr = phaseR[job.chan];
+    int outCount = 0;
+
+    for (int n0 = 0; n0 < Block; n0 += Lanes) {
+      if (kq >= job.inCount) break;
+
+      AccT acc[Lanes];
+      bool active[Lanes];
+      int tap[Lanes];
+      int in[Lanes];
+#pragma hls_unroll yes
+      for (int l = 0; l < Lanes; l++) {
+        acc[l] = 0;
+        active[l] = kq < job.inCount;
+        // k - (taps-1) as quotient and remainder
+        int bq = kq - job.tapsQ;
+        int br = kr - job.tapsR;
+        if (br < 0) {
+          br += L;
+          bq -= 1;
+        }
+        tap[l] = br == 0 ? 0 : L - br;
+        in[l] = br == 0 ? bq : bq + 1;
+        if (active[l]) {
+          kq += job.decimQ;
+          kr += job.decimR;
+          if (kr >= L) {
+            kr -= L;
+            kq += 1;
+          }
+        }
+      }
+
+      for (int s = 0; s < Taps; s++) {
+        if (s == job.tapsPerPhase) break;
+#pragma hls_unroll yes
+        for (int l = 0; l < Lanes; l++) {
+          if (active[l] && tap[l] < job.taps) {
+            acc[l] += weights[job.set][tap[l]]*bufferAt(job.chan, in[l]);
+          }
+          tap[l] += L;
+          in[l] += 1;
+        }
+        wait();
+      }
+
+#pragma hls_unroll yes
+      for (int l = 0; l < Lanes; l++) {
+        if (active[l]) {
+          outputArray[outCount] = acc[l];
+          outCount++;
+        }
+      }
+    }
+
+    phaseQ[job.chan] = kq - job.inCount;
+    phaseR[job.chan] = kr;
+    CDCOUT(sc_time_stamp() << " " << name() << " FIR polyphase block: " << dec << job.inCount
+                  << " inputs, " << outCount << " outputs, " << job.tapsPerPhase
+                  << " taps per phase" << endl, kPerfDebugLevel);
+    return outCount;
+  }
+
+  // Complex FIR on interleaved I/Q history.  Lane l computes complex
+  // output n = n0+l; each clock it reads one complex sample and applies
+  // one real or complex tap to it.
+  void computeComplex(const job_t &job)
+  {
+    const int cplxBlock = Block/2;
+
+    for (int n0 = 0; n0 < cplxBlock; n0 += Lanes) {
+      AccT accI[Lanes];
+      AccT accQ[Lanes];
+#pragma hls_unroll yes
+      for (int l = 0; l < Lanes; l++) {
+        accI[l] = 0;
+        accQ[l] = 0;
+      }
+
+      for (int m = 0; m < Taps/2; m++) {
+        if (m == job.taps) break;
+        SampleT wr = weights[job.set][m];
+        SampleT wi = 0;
+        if (job.cplxCoef) {
+          wr = weights[job.set][2*m];
+          wi = weights[job.set][2*m + 1];
+        }
+#pragma hls_unroll yes
+        for (int l = 0; l < Lanes; l++) {
+          const int k = n0 + l - job.taps + 1 + m;
+          AccT xi = bufferAt(job.chan, 2*k);
+          AccT xq = bufferAt(job.chan, 2*k + 1);
+          accI[l] += wr*xi - wi*xq;
+          accQ[l] += wr*xq + wi*xi;
+        }
+        wait();
+      }
+
+#pragma hls_unroll yes
+      for (int l = 0; l < Lanes; l++) {
+        if (n0 + l < cplxBlock) {
+          outputArray[2*(n0 + l)] = accI[l];
+          outputArray[2*(n0 + l) + 1] = accQ[l];
+        }
+      }
+    }
+    CDCOUT(sc_time_stamp() << " " << name() << " FIR complex block: " << dec << job.taps << " taps x "
+                  << cplxBlock << " outputs (" << (job.cplxCoef ? "complex" : "real")
+                  << " coefficients)" << endl, kPerfDebugLevel);
+  }
+
+  // Wide product scaled down by `frac` fraction bits, rounded to nearest
+  static fft_t fftRound(const fftWide_t &val, int frac)
+  {
+    return fft_t((val + (fftWide_t(1) << (frac - 1))) >> frac);
+  }
+
+  // Index i with its fftBits bits in reverse order
+  static int bitReverse(int i)
+  {
+    int r = 0;
+#pragma hls_unroll yes
+    for (int b = 0; b < fftBits; b++) {
+      r = (r << 1) | ((i >> b) & 1);
+    }
+    return r;
+  }
+
+  // In-place radix-2 transform of fftRe/fftIm, which hold the input in
+  // bit-reversed order.  One butterfly per clock; the data grows by at
+  // most one bit per stage and is not scaled.  The inverse transform
+  // uses conjugate twiddles and is not divided by fftLen.
+  void fft(bool inverse)
+  {
+    for (int s = 0; s < fftBits; s++) {
+      const int half = 1 << s;
+      for (int b = 0; b < fftLen/2; b++) {
+        const int j = b & (half - 1);
+        const int i0 = ((b >> s) << (s + 1)) + j;
+        const int i1 = i0 + half;
+        const int t = j << (fftBits - 1 - s);
+        fftTw_t wr = twiddles::re[t];
+        fftTw_t wi = twiddles::im[t];
+        if (inverse) wi = -wi;
+        fft_t tr = fftRound(fftWide_t(fftRe[i1])*wr - fftWide_t(fftIm[i1])*wi, fftTwFrac);
+        fft_t ti = fftRound(fftWide_t(fftRe[i1])*wi + fftWide_t(fftIm[i1])*wr, fftTwFrac);
+        fftRe[i1] = fftRe[i0] - tr;
+        fftIm[i1] = fftIm[i0] - ti;
+        fftRe[i0] = fftRe[i0] + tr;
+        fftIm[i0] = fftIm[i0] + ti;
+        wait();
+      }
+    }
+  }
+
+  // Make sure the spectrum of the job's set is that of its first
+  // job.taps coefficients, zero padded to fftLen.  Weight m multiplies
+  // the sample taps-1-m back, so the impulse response is reversed.
+  void loadCoefSpectrum(const job_t &job)
+  {
+    if (coefSpecTaps[job.set] == job.taps) return;
+    for (int i = 0; i < fftLen; i++) {
+      fft_t h = 0;
+      if (i < job.taps) h = fft_t((long long)weights[job.set][job.taps - 1 - i]) << fftGuard;
+      fftRe[bitReverse(i)] = h;
+      fftIm[bitReverse(i)] = 0;
+    }
+    fft(false);
+    for (int k = 0; k < fftLen; k++) {
+      coefSpecRe[job.set][k] = fftRe[k];
+      coefSpecIm[job.set][k] = fftIm[k];
+    }
+    coefSpecTaps[job.set] = job.taps;
+  }
+
+  // Overlap-save fast convolution.  The window is the fftLen samples
+  // ending with the new block; its circular convolution with the taps is
+  // the linear one for the last fftLen-taps+1 >= Block positions.
+  void computeFft(const job_t &job)
+  {
+    loadCoefSpectrum(job);
+    for (int i = 0; i < fftLen; i++) {
+      fftRe[bitReverse(i)] = fft_t((long long)bufferAt(job.chan, Block - fftLen + i)) << fftGuard;
+      fftIm[bitReverse(i)] = 0;
+      wait();
+    }
+    fft(false);
+
+    // bin products, divided by fftLen for the inverse, back in bit-reversed
+    // order; the guard bits of one factor are dropped
+    for (int k = 0; k < fftLen; k++) {
+      fft_t xr = fftRe[k];
+      fft_t xi = fftIm[k];
+      fft_t hr = coefSpecRe[job.set][k];
+      fft_t hi = coefSpecIm[job.set][k];
+      fftWide_t pr = fftWide_t(xr)*hr - fftWide_t(xi)*hi;
+      fftWide_t pi = fftWide_t(xr)*hi + fftWide_t(xi)*hr;
+      fftRe[k] = fftRound(pr, fftGuard + fftBits);
+      fftIm[k] = fftRound(pi, fftGuard + fftBits);
+      wait();
+    }
+    for (int k = 0; k < fftLen; k++) {
+      const int r = bitReverse(k);
+      if (k < r) {
+        fft_t tr = fftRe[k];
+        fft_t ti = fftIm[k];
+        fftRe[k] = fftRe[r];
+        fftIm[k] = fftIm[r];
+        fftRe[r] = tr;
+        fftIm[r] = ti;
+      }
+    }
+    fft(true);
+
+    for (int n = 0; n < Block; n++) {
+      outputArray[n] = fftRound(fftWide_t(fftRe[fftLen - Block + n]), fftGuard).to_int64();
+    }
+    CDCOUT(sc_time_stamp() << " " << name() << " FIR FFT block: " << dec << job.taps << " taps x "
+                  << Block << " outputs in about " << fftCycles << " cycles (" << fftLen
+                  << " point transforms)" << endl, kPerfDebugLevel);
+  }
+
+  // Constant-coefficient filter: the window holds the inputs of taps
+  // constFirst..constLast of the current output and moves one sample per
+  // clock, and the shift-add network of every tap is applied at once.
+  void computeConstBlock(const job_t &job)
+  {
+    SampleT window[constSpan];
+#pragma hls_unroll yes
+    for (int k = 0; k < constSpan - 1; k++) {
+      window[k + 1] = bufferAt(job.chan, constFirst + k - Taps + 1);
+    }
+
+    for (int n = 0; n < Block; n++) {
+#pragma hls_unroll yes
+      for (int k = 0; k < constSpan - 1; k++) {
+        window[k] = window[k + 1];
+      }
+      window[constSpan - 1] = bufferAt(job.chan, n + constLast - Taps + 1);
+      outputArray[n] = firConstTaps<ConstCoefs, constFirst, constFirst, constLast + 1>::template sum<AccT>(window);
+      wait();
+    }
+    CDCOUT(sc_time_stamp() << " " << name() << " FIR constant block: " << dec << constSpan << " of "
+                  << Taps << " taps, " << constAdders << " adders x " << Block << " outputs in "
+                  << Block << " cycles" << endl, kPerfDebugLevel);
+  }
+
+  // Filter the new inputs at histHead into outputArray and return the
+  // number of outputs.  The history is left as it is.
+  int computeOutputs(const job_t &job)
+  {
+    int outCount = job.inCount;
+    if (job.cplx) {
+      computeComplex(job);
+    } else if (job.decim == 1 && job.interp == 1) {
+      if (ConstCoefs::taps != 0) {
+        computeConstBlock(job);
+      } else if (FftTaps && job.taps >= FftTaps) {
+        computeFft(job);
+      } else if (Lanes == 1) {
+        computeListBlock(job);
+      } else {
+        computeBlock(job);
+      }
+    } else {
+      outCount = computePolyphase(job);
+    }
+    return outCount;
+  }
+
+  // Filter the new inputs at histHead, then move the history on.
+  // Returns the number of outputs in outputArray.
+  int filterBlock(const job_t &job)
+  {
+    int outCount = computeOutputs(job);
+    histHead[job.chan] += job.inCount;
+    return outCount;
+  }
+
+  // Streaming FIR: one sample in, one filtered sample out per clock.
+  // All taps are unrolled so the loop can be pipelined at II=1.
+  // Taps, output scaling and decimation of the streaming path; unlike
+  // decodeJob() this leaves the channel contexts alone and does not divide
+  static job_t decodeStage(const reg_t &cfg)
+  {
+    job_t stage;
+    stage.taps = nvhls::get_slc<cfgTapsWidth>(cfg, cfgTapsLsb).to_int();
+    if (stage.taps == 0 || stage.taps > Taps) stage.taps = Taps;
+    stage.shift = nvhls::get_slc<cfgShiftWidth>(cfg, cfgShiftLsb).to_int();
+    if (stage.shift >= accWidth) stage.shift = accWidth - 1;
+    stage.sat = cfg[cfgSatBit];
+    stage.decim = nvhls::get_slc<cfgRateWidth>(cfg, cfgDecimLsb).to_int();
+    if (stage.decim == 0) stage.decim = 1;
+    return stage;
+  }
+
+  void runStream()
+  {
+    sampleIn.Reset();
+    sampleOut.Reset();
+
+    SampleT shiftReg[Taps];
+#pragma hls_unroll yes
+    for (int m = 0; m < Taps; m++) {
+      shiftReg[m] = 0;
+    }
+    NVUINTW(cfgRateWidth) phase = 0;
+
+    // stage settings, decoded from cfgReg when it changes
+    reg_t stageCfg = 0;
+    job_t stage = decodeStage(stageCfg);
+
+    #pragma hls_pipeline_init_interval 1
+    #pragma pipeline_stall_mode flush
+    while (1) {
+      wait();
+      stream_t in = sampleIn.Pop();
+
+      if (regOut_chan[cfgReg].read() != stageCfg) {
+        stageCfg = regOut_chan[cfgReg].read();
+        stage = decodeStage(stageCfg);
+        phase = 0;
+      }
+
+      // the newest sample enters at tap taps-1, so taps 0..taps-1 hold
+      // the window of a taps-long filter and the rest are unused
+#pragma hls_unroll yes
+      for (int m = 0; m < Taps; m++) {
+        if (m == stage.taps - 1) {
+          shiftReg[m] = toSample(in);
+        } else if (m < stage.taps - 1) {
+          shiftReg[m] = shiftReg[m + 1];
+        }
+      }
+
+      AccT acc = 0;
+#pragma hls_unroll yes
+      for (int m = 0; m < Taps; m++) {
+        if (m < stage.taps) {
+          acc += unpackSample(regOut_chan[coefReg + m/samplesPerReg].read(), m%samplesPerReg)*shiftReg[m];
+        }
+      }
+
+      // decimating by cfgReg[15:8] keeps every M-th output
+      if (phase == 0) {
+        sampleOut.Push(stream_t(scaleOutput<sampleWidth>(acc, stage)));
+      }
+      phase += 1;
+      if (phase >= stage.decim) {
+        phase = 0;
+      }
+    }
+  }
+
+
+  // Write a register through the slave's regIn port
+  void writeReg(int reg, const reg_t &data)
   {
-    
-    regIn_chan.ResetWrite();
     reg_write_ regwr;
-    //clear FIR status register
-    regwr.addr = 10*8;
-    regwr.data = 0;
-    NVUINTW(axi_::DATA_WIDTH) lastCtrl = 0;
-    
+    regwr.addr = reg*bytesPerReg;
+    regwr.data = data;
+    regWrite.Push(regwr);
+  }
+
+  // Copy the coefficient registers into a set
+  void loadWeights(int set)
+  {
+    for (int i = 0; i < Taps; i++) {
+      weights[set][i] = unpackSample(regOut_chan[coefReg + i/samplesPerReg].read(), i%samplesPerReg);
+    }
+    findTapSpan(set);
+    if (FftTaps) {
+      coefSpecTaps[set] = 0;
+    }
+  }
+
+  // Find the first and last nonzero weights of a set and compact all of
+  // them into its tap list
+  void findTapSpan(int set)
+  {
+    int first = Taps;
+    int last = -1;
+    int count = 0;
+    for (int i = 0; i < Taps; i++) {
+      if (weights[set][i] != 0) {
+        if (first == Taps) first = i;
+        last = i;
+        tapList[set][count] = i;
+        count++;
+      }
+    }
+    tapFirst[set] = first;
+    tapLast[set] = last;
+    tapCount[set] = count;
+  }
+
+  // Control state after reset.  The weights are not cleared, so the tap
+  // span and list of each set cover every tap until the set is loaded,
+  // and every FFT spectrum is stale.
+  void resetControl()
+  {
+    for (int s = 0; s < CoefSets; s++) {
+      tapFirst[s] = 0;
+      tapLast[s] = Taps - 1;
+      for (int i = 0; i < Taps; i++) {
+        tapList[s][i] = i;
+      }
+      tapCount[s] = Taps;
+    }
+    for (int s = 0; s < fftSets; s++) {
+      coefSpecTaps[s] = 0;
+    }
+    for (int c = 0; c < Channels; c++) {
+      histHead[c] = 0;
+      phaseQ[c] = 0;
+      phaseR[c] = 0;
+      chanPhaseCfg[c] = 0;
+      chanSet[c] = 0;
+    }
+  }
+
+  // Append one packed register of new samples to the history
+  void loadBlockWord(int chan, int r, const reg_t &word, int count)
+  {
+    for (int i = 0; i < samplesPerReg; i++) {
+      if (r*samplesPerReg + i < count) {
+        inputBuffer[chan][(histHead[chan].to_int() + r*samplesPerReg + i) & (histLen - 1)] = unpackSample(word, i);
+      }
+    }
+  }
+
+  // One packed register of filtered outputs
+  reg_t storeBlockWord(const job_t &job, int r, int count)
+  {
+    reg_t word = 0;
+    for (int i = 0; i < outsPerReg; i++) {
+      if (r*outsPerReg + i < count) {
+        packOutput(word, i, outputArray[r*outsPerReg + i], job);
+      }
+    }
+    return word;
+  }
+
+  // Registers holding count packed samples
+  static int regsFor(int count)
+  {
+    return (count + samplesPerReg - 1) / samplesPerReg;
+  }
+
+  // Registers holding count packed outputs
+  static int outRegsFor(int count)
+  {
+    return (count + outsPerReg - 1) / outsPerReg;
+  }
+
+  // Read count samples from memory in one AXI burst
+  void loadBlockMem(int chan, const reg_t &addr, int count)
+  {
+    const int regs = regsFor(count);
+    typename axi_::AddrPayload rd_req;
+    rd_req.id = 0;
+    rd_req.addr = addr;
+    rd_req.len = regs - 1;
+    axi_mst_read.ar.Push(rd_req);
+    for (int r = 0; r < numBlockReg; r++) {
+      if (r == regs) break;
+      typename axi_::ReadPayload rd_resp = axi_mst_read.r.Pop();
+      loadBlockWord(chan, r, rd_resp.data, count);
+    }
+  }
+
+  // Write count outputs to memory in one AXI burst
+  void storeBlockMem(const job_t &job, const reg_t &addr, int count)
+  {
+    const int regs = outRegsFor(count);
+    typename axi_::AddrPayload wr_req;
+    typename axi_::WritePayload wr_data;
+    NVUINTW(axi_::WSTRB_WIDTH) wstrb = ~0;
+    wr_req.id = 0;
+    wr_req.addr = addr;
+    wr_req.len = regs - 1;
+    axi_mst_write.aw.Push(wr_req);
+    for (int r = 0; r < numOutReg; r++) {
+      if (r == regs) break;
+      wr_data.data = storeBlockWord(job, r, count);
+      wr_data.wstrb = wstrb;
+      if (r == regs - 1) {
+        //a partly filled last register writes only its outputs' bytes
+        const int bytes = ((count - r*outsPerReg)*outWidth + 7)/8;
+        if (bytes < bytesPerReg) wr_data.wstrb = (1 << bytes) - 1;
+      }
+      wr_data.last = (r == regs - 1);
+      axi_mst_write.w.Push(wr_data);
+    }
+    axi_mst_write.b.Pop();
+  }
+
+  void resetStats()
+  {
+    statEnergy = 0;
+    statPeak = 0;
+    statIndex = 0;
+    statCount = 0;
+  }
+
+  // Fold a block's outputs into the job's energy and peak
+  void updateStats(const job_t &job, int count)
+  {
+    for (int i = 0; i < Block; i++) {
+      if (i == count) break;
+      long long y = scaleOutput(outputArray[i], job);
+      long long mag = y < 0 ? -y : y;
+      statEnergy += reg_t(y*y);
+      if (mag > statPeak.to_int64()) {
+        statPeak = mag;
+        statIndex = statCount + i;
+      }
+    }
+    statCount += count;
+  }
+
+  // Write the post-processing results; returns the threshold flag
+  bool writeStats()
+  {
+    reg_t thresh = regOut_chan[threshReg].read();
+    bool crossed = thresh != 0 && reg_t(statPeak) >= thresh;
+    reg_t peak = 0;
+    peak = nvhls::set_slc(peak, statPeak, 0);
+    //saturate the index rather than wrap it for long jobs
+    const int maxIndex = (1 << peakIndexWidth) - 1;
+    peak = nvhls::set_slc(peak, NVUINTW(peakIndexWidth)(statIndex < maxIndex ? statIndex : maxIndex), peakIndexLsb);
+    peak = nvhls::set_slc(peak, NVUINTW(1)(crossed), peakThreshBit);
+    writeReg(energyReg, statEnergy);
+    writeReg(peakReg, peak);
+    return crossed;
+  }
+
+  // Publish the job and sample counts
+  void writeCounts()
+  {
+    writeReg(jobCountReg, jobCount);
+    writeReg(sampleCountReg, sampleCount);
+  }
+
+  // Settings of the block starting at sample done of a count sample job:
+  // the last block takes only the samples that are left
+  static job_t blockOf(const job_t &job, const reg_t &done, const reg_t &count)
+  {
+    job_t blk = job;
+    if (count - done < job.inCount) {
+      blk.inCount = reg_t(count - done).to_int();
+    }
+    return blk;
+  }
+
+  // Filter count samples from src to dst, one block per read burst,
+  // MAC pass and write burst
+  void runMasterJob(const job_t &job, reg_t src, reg_t dst, const reg_t &count)
+  {
+    selectPhase(job);
+    for (reg_t done = 0; done < count; done += job.inCount) {
+      const job_t blk = blockOf(job, done, count);
+      loadBlockMem(job.chan, src, blk.inCount);
+      int outCount = filterBlock(blk);
+      if (job.stats) {
+        updateStats(job, outCount);
+      }
+      if (outCount > 0) {
+        storeBlockMem(job, dst, outCount);
+      }
+      src += regsFor(job.inCount)*bytesPerReg;
+      dst += outRegsFor(outCount)*bytesPerReg;
+    }
+    jobCount += 1;
+    sampleCount += count;
+  }
+
+  // Filter-bank job: every input block is read once and filtered with
+  // each of the sets, then the history moves on.  The resampling phase
+  // is the same for every set.
+  void runBankJob(job_t job, reg_t src, reg_t dst, const reg_t &count)
+  {
+    const reg_t stride = regOut_chan[bankStrideReg].read();
+    int sets = regOut_chan[bankSetsReg].read().to_int();
+    if (sets == 0 || sets > CoefSets) sets = CoefSets;
+    selectPhase(job);
+
+    for (reg_t done = 0; done < count; done += job.inCount) {
+      job_t blk = blockOf(job, done, count);
+      loadBlockMem(job.chan, src, blk.inCount);
+      const int kq = phaseQ[job.chan];
+      const int kr = phaseR[job.chan];
+      int outCount = 0;
+      reg_t setDst = dst;
+      for (int s = 0; s < CoefSets; s++) {
+        if (s == sets) break;
+        phaseQ[job.chan] = kq;
+        phaseR[job.chan] = kr;
+        blk.set = s;
+        outCount = computeOutputs(blk);
+        if (outCount > 0) {
+          storeBlockMem(blk, setDst, outCount);
+        }
+        setDst += stride;
+      }
+      histHead[job.chan] += blk.inCount;
+      src += regsFor(job.inCount)*bytesPerReg;
+      dst += outRegsFor(outCount)*bytesPerReg;
+    }
+    jobCount += 1;
+    sampleCount += count;
+  }
+
+  // Coefficient set named by a control or descriptor field
+  static int toSet(const reg_t &field)
+  {
+    int set = nvhls::get_slc<ctrlSetWidth>(field, 0).to_int();
+    return set < CoefSets ? set : 0;
+  }
+
+  // Channel named by a control or descriptor field
+  static int toChan(const reg_t &field)
+  {
+    int chan = nvhls::get_slc<ctrlChanWidth>(field, 0).to_int();
+    return chan < Channels ? chan : 0;
+  }
+
+  // Select the job's channel and coefficient set.  A job either names a
+  // set, which is then bound to the channel, or runs with the channel's.
+  void selectContext(job_t &job, const reg_t &setField, bool chanSetUsed, const reg_t &chanField)
+  {
+    job.chan = toChan(chanField);
+    if (chanSetUsed) {
+      job.set = chanSet[job.chan];
+    } else {
+      job.set = toSet(setField);
+      chanSet[job.chan] = job.set;
+    }
+  }
+
+  // Decode the control and cfg registers into job settings.  Tap count
+  // 0 or out of range selects Taps, rate factor 0 means 1.
+  job_t decodeJob(const reg_t &ctrl, const reg_t &cfg)
+  {
+    job_t job;
+    job.sym = ctrl[ctrlSymBit];
+    selectContext(job, ctrl >> ctrlSetLsb, ctrl[ctrlChanSetBit], ctrl >> ctrlChanLsb);
+    job.cplx = cfg[cfgCplxBit];
+    job.cplxCoef = job.cplx && cfg[cfgCplxCoefBit];
+    job.stats = cfg[cfgStatsBit];
+    const int maxTaps = job.cplx ? Taps/2 : Taps;
+    job.taps = nvhls::get_slc<cfgTapsWidth>(cfg, cfgTapsLsb).to_int();
+    if (job.taps == 0 || job.taps > maxTaps) job.taps = maxTaps;
+    job.shift = nvhls::get_slc<cfgShiftWidth>(cfg, cfgShiftLsb).to_int();
+    if (job.shift >= accWidth) job.shift = accWidth - 1;
+    job.sat = cfg[cfgSatBit];
+    job.decim = nvhls::get_slc<cfgRateWidth>(cfg, cfgDecimLsb).to_int();
+    if (job.decim == 0) job.decim = 1;
+    job.interp = nvhls::get_slc<cfgRateWidth>(cfg, cfgInterpLsb).to_int();
+    if (job.interp == 0 || job.interp > Block) job.interp = 1;
+    if (job.cplx) {
+      job.decim = 1;
+      job.interp = 1;
+    }
+
+    job.inCount = Block / job.interp;
+    job.tapsQ = (job.taps - 1) / job.interp;
+    job.tapsR = (job.taps - 1) % job.interp;
+    job.decimQ = job.decim / job.interp;
+    job.decimR = job.decim % job.interp;
+    job.tapsPerPhase = (job.taps + job.interp - 1) / job.interp;
+    job.phaseCfg = nvhls::get_slc<cfgPhaseWidth>(cfg, 0).to_int();
+    return job;
+  }
+
+  // Restart the channel's resampling phase if it was computed with other
+  // taps or rate factors than the job's
+  void selectPhase(const job_t &job)
+  {
+    if (chanPhaseCfg[job.chan] != job.phaseCfg) {
+      chanPhaseCfg[job.chan] = job.phaseCfg;
+      phaseQ[job.chan] = 0;
+      phaseR[job.chan] = 0;
+    }
+  }
+
+  // Write a channel's phase, set and history to memory in one burst
+  void saveContext(int chan, const reg_t &addr)
+  {
+    typename axi_::AddrPayload wr_req;
+    typename axi_::WritePayload wr_data;
+    NVUINTW(axi_::WSTRB_WIDTH) wstrb = ~0;
+    wr_req.id = 0;
+    wr_req.addr = addr;
+    wr_req.len = ctxWords - 1;
+    axi_mst_write.aw.Push(wr_req);
+
+    reg_t word = 0;
+    word = nvhls::set_slc(word, NVUINTW(ctxPhaseWidth)(phaseQ[chan]), ctxPhaseQLsb);
+    word = nvhls::set_slc(word, NVUINTW(ctxPhaseWidth)(phaseR[chan]), ctxPhaseRLsb);
+    word = nvhls::set_slc(word, NVUINTW(ctrlSetWidth)(chanSet[chan]), ctxSetLsb);
+    word = nvhls::set_slc(word, NVUINTW(cfgPhaseWidth)(chanPhaseCfg[chan]), ctxPhaseCfgLsb);
+    for (int r = 0; r < ctxWords; r++) {
+      if (r > 0) {
+        word = 0;
+        for (int i = 0; i < samplesPerReg; i++) {
+          int h = (r - 1)*samplesPerReg + i;
+          if (h < ctxHistLen) {
+            word = nvhls::set_slc(word, toBits(bufferAt(chan, h - ctxHistLen)), i*sampleWidth);
+          }
+        }
+      }
+      wr_data.data = word;
+      wr_data.wstrb = wstrb;
+      wr_data.last = (r == ctxWords - 1);
+      axi_mst_write.w.Push(wr_data);
+    }
+    axi_mst_write.b.Pop();
+  }
+
+  // Read a channel's phase, set and history back from memory
+  void restoreContext(int chan, const reg_t &addr)
+  {
+    typename axi_::AddrPayload rd_req;
+    rd_req.id = 0;
+    rd_req.addr = addr;
+    rd_req.len = ctxWords - 1;
+    axi_mst_read.ar.Push(rd_req);
+
+    for (int r = 0; r < ctxWords; r++) {
+      reg_t word = axi_mst_read.r.Pop().data;
+      if (r == 0) {
+        phaseQ[chan] = nvhls::get_slc<ctxPhaseWidth>(word, ctxPhaseQLsb).to_int();
+        phaseR[chan] = nvhls::get_slc<ctxPhaseWidth>(word, ctxPhaseRLsb).to_int();
+        chanSet[chan] = toSet(word >> ctxSetLsb);
+        chanPhaseCfg[chan] = nvhls::get_slc<cfgPhaseWidth>(word, ctxPhaseCfgLsb).to_int();
+      } else {
+        for (int i = 0; i < samplesPerReg; i++) {
+          int h = (r - 1)*samplesPerReg + i;
+          if (h < ctxHistLen) {
+            inputBuffer[chan][(histHead[chan].to_int() + h - ctxHistLen) & (histLen - 1)] = unpackSample(word, i);
+          }
+        }
+      }
+    }
+  }
+
+  // Work through the descriptor ring until the command changes
+  void runRing(job_t job)
+  {
+    reg_t idx = regOut_chan[ringDoneReg].read();
+    reg_t desc[descWords];
+
+    while (nvhls::get_slc<ctrlCmdWidth>(regOut_chan[ctrlReg].read(), 0) == cmdRing) {
+      if (idx == regOut_chan[ringTailReg].read()) {
+        busy_chan.write(0);
+        wait();
+#ifndef __SYNTHESIS__
+        //sleep until software queues work or stops the ring
+        if (idx == regOut_chan[ringTailReg].read()) {
+          wait(regOut_chan[ringTailReg].value_changed_event() | regOut_chan[ctrlReg].value_changed_event());
+          wait();
+        }
+#endif
+        continue;
+      }
+      busy_chan.write(1);
+
+      typename axi_::AddrPayload rd_req;
+      rd_req.id = 0;
+      rd_req.addr = regOut_chan[ringBaseReg].read() + idx*(descWords*bytesPerReg);
+      rd_req.len = descWords - 1;
+      axi_mst_read.ar.Push(rd_req);
+      for (int w = 0; w < descWords; w++) {
+        desc[w] = axi_mst_read.r.Pop().data;
+      }
+
+      selectContext(job, desc[3] >> descSetLsb, desc[3][ctrlChanSetBit], desc[3] >> ctrlChanLsb);
+      runMasterJob(job, desc[0], desc[1], desc[2]);
+
+      idx += 1;
+      if (idx == regOut_chan[ringSizeReg].read()) idx = 0;
+      writeCounts();
+      writeReg(ringDoneReg, idx);
+    }
+  }
+
+  void run()
+  {
+
+    regWrite.Reset();
+    axi_mst_read.reset();
+    axi_mst_write.reset();
+    reg_t lastCtrl = 0;
+    jobCount = 0;
+    sampleCount = 0;
+    busy_chan.write(0);
+    resetControl();
+
 
     while (1)
     {
-        //flush regOut FIFO
-        //this should not be neccesary, but the simulation required a dummy transaction to work
-        wait();
-        //dummy transaction
-        regIn_chan.TransferNBWrite();
         wait();
+#ifndef __SYNTHESIS__
+        //nothing to do until the control register changes, so sleep
+        //instead of waking every clock; the extra wait() realigns to the clock
+        if (regOut_chan[ctrlReg].read() == lastCtrl) {
+          wait(regOut_chan[ctrlReg].value_changed_event());
+          wait();
+        }
+#endif
 
-        if(regOut_chan[1].read() != lastCtrl) {
-          lastCtrl = regOut_chan[1].read();
-
-          //watch for control register change to 2 (FIR start code)
-          if(regOut_chan[1].read() == 0x02) {
-            //read weights in
-            for(int i = 0; i < 4; i+= 1) {
-                weights[i + 0] = regOut_chan[2].read().slc<16>(i*16);
-                weights[i + 4] = regOut_chan[3].read().slc<16>(i*16);
-                weights[i + 8] = regOut_chan[4].read().slc<16>(i*16);
-                weights[i + 12] = regOut_chan[5].read().slc<16>(i*16);
-            }
-            //shift old inputs
-            for(int i = 0; i < 16; i+=1) {
-              inputBuffer[i] = inputBuffer[i + 16];
-            }
-            wait();
+        if(regOut_chan[ctrlReg].read() != lastCtrl) {
+          lastCtrl = regOut_chan[ctrlReg].read();
+          NVUINTW(ctrlCmdWidth) cmd = nvhls::get_slc<ctrlCmdWidth>(lastCtrl, 0);
+          bool bank = lastCtrl[ctrlBankBit];
+          busy_chan.write(1);
+#ifndef __SYNTHESIS__
+          const sc_time start = sc_time_stamp();
+#endif
 
-            //process new inputs
-            for(int i = 0; i < 4; i+= 1) {
-              inputBuffer[i + 16] = regOut_chan[6].read().slc<16>(i*16);
-              inputBuffer[i + 20] = regOut_chan[7].read().slc<16>(i*16);
-              inputBuffer[i + 24] = regOut_chan[8].read().slc<16>(i*16);
-              inputBuffer[i + 28] = regOut_chan[9].read().slc<16>(i*16);
+          if (cmd == cmdSave || cmd == cmdRestore) {
+            //move a channel context to or from memory
+            int chan = toChan(lastCtrl >> ctrlChanLsb);
+            if (cmd == cmdSave) {
+              saveContext(chan, regOut_chan[ctxAddrReg].read());
+            } else {
+              restoreContext(chan, regOut_chan[ctxAddrReg].read());
             }
+            writeReg(statusReg, statusDone);
+          }
 
-            //FIR computation
-            for (int n=0; n<32; n++) {
-              outputArray[n]=0;
-              for (int m=0; m<TAPS; m++) {
-                if (n+m-TAPS+1 >= 0) {
-                  outputArray[n]+=weights[m]*inputBuffer[n+m-TAPS+1];
-                }
-              }
-            }
+          //watch for control register change to a FIR start code
+          if(cmd == cmdStart || cmd == cmdMaster || cmd == cmdRing || cmd == cmdLoadCoef || cmd == cmdBank) {
+            job_t job = decodeJob(lastCtrl, regOut_chan[cfgReg].read());
+            int outCount = Block;
+            bool crossed = false;
+            resetStats();
 
-            // Write FIR results to regOut's
-            // A for loop would make sense here to adhere to DRY
-            // simulator had a tough time with loop, so it is manually unrolled
-            regwr.data = SHORTS_TO_LONG(outputArray[16], outputArray[17], outputArray[18], outputArray[19]);
-            regwr.addr = 80;
-            regIn_chan.Push(regwr);
-            regIn_chan.TransferNBWrite();
-            wait();
-            wait();
+            //latch the shadow coefficient registers unless a stored set is used
+            if (!lastCtrl[ctrlStoredBit]) {
+              loadWeights(job.set);
+            }
             wait();
 
-            regwr.data = SHORTS_TO_LONG(outputArray[20], outputArray[21], outputArray[22], outputArray[23]);
-            regwr.addr = 88;
-            regIn_chan.Push(regwr);
-            regIn_chan.TransferNBWrite();
-            wait();
-            wait();
-            wait();
+            if (cmd == cmdLoadCoef) {
+              //coefficients only
+            } else if (cmd == cmdRing) {
+              //the results would be overwritten descriptor by descriptor
+              job.stats = false;
+              runRing(job);
+            } else if (cmd == cmdStart) {
+              //process new inputs from the selected register bank
+              selectPhase(job);
+              const int blockInReg = bank ? (int)inReg1 : (int)inReg;
+              const int blockOutReg = bank ? (int)outReg1 : (int)outReg;
+              for (int r = 0; r < numBlockReg; r++) {
+                loadBlockWord(job.chan, r, regOut_chan[blockInReg + r].read(), job.inCount);
+              }
 
+              //FIR computation
+              outCount = filterBlock(job);
+              jobCount += 1;
+              sampleCount += job.inCount;
+              if (job.stats) {
+                updateStats(job, outCount);
+              }
 
-            regwr.addr = 96;
-            regwr.data = SHORTS_TO_LONG(outputArray[24], outputArray[25], outputArray[26], outputArray[27]);
-            regIn_chan.Push(regwr);
-            regIn_chan.TransferNBWrite();
-            wait();
-            wait();
-            wait();
+              // Write FIR results to regOut's, one packed register at a time
+              for (int r = 0; r < numOutReg; r++) {
+                if (r == outRegsFor(outCount)) break;
+                writeReg(blockOutReg + r, storeBlockWord(job, r, outCount));
+              }
+            } else if (cmd == cmdBank) {
+              runBankJob(job, regOut_chan[srcAddrReg].read(), regOut_chan[dstAddrReg].read(), regOut_chan[lenReg].read());
+            } else {
+              runMasterJob(job, regOut_chan[srcAddrReg].read(), regOut_chan[dstAddrReg].read(), regOut_chan[lenReg].read());
+            }
 
-            regwr.addr = 104;
-            regwr.data = SHORTS_TO_LONG(outputArray[28], outputArray[29], outputArray[30], outputArray[31]);
-            regIn_chan.Push(regwr);
-            regIn_chan.TransferNBWrite();
-            wait();
-            wait();
-            wait();
+            if (job.stats && (cmd == cmdStart || cmd == cmdMaster)) {
+              crossed = writeStats();
+            }
 
-            regwr.data = 3;
-            regwr.addr = 0;
-            regIn_chan.Push(regwr);
-            regIn_chan.TransferNBWrite();
-            wait();
+            if (cmd != cmdLoadCoef) {
+              writeCounts();
+            }
+
+            reg_t status = statusDone | ((int)bank << statusBankBit) | ((int)crossed << statusThreshBit);
+            //only a resampling block has a variable number of outputs
+            if (cmd == cmdStart && (job.decim != 1 || job.interp != 1)) {
+              status |= (reg_t)outCount << statusCountLsb;
+            }
+            writeReg(statusReg, status);
+            CDCOUT(sc_time_stamp() << " " << name() << " command " << dec << cmd << " done in "
+                          << clocksSince(start) << " cycles" << endl, kPerfDebugLevel);
           }
+          busy_chan.write(0);
         }
     }
     }
@@ -9,12 +9,19 @@ SystemC Transaction Level Modeling Tutorial
 #include "nvhls_pch.h"
 //#include <tlm.h>
 #include <stdlib.h>
+#include <string>
 #include "spike.h"
 #include "memctl.h"
 #include "SimpleBusLT.h"
 #include "SimpleBusLT16.h"
 #include "dma.h"
 #include "TlmToAxi.h"
+#include "dispatch.h"
+
+// Number of firUnits in the cluster behind bus1, e.g. "make FIR_UNITS=4"
+#ifndef FIR_UNITS
+#define FIR_UNITS 1
+#endif
 
 int sc_main (int argc,char  *argv[])
 {
@@ -22,16 +29,31 @@ int sc_main (int argc,char  *argv[])
   time(&begin_time);
   spike cpu("cpu",argc,argv,false);
   memctl mem("mem",0x10000,false);
-  TlmToAxi tlm2axi("tlm2axi");
-  SimpleBusLT<2,2> bus0("bus0");
-  SimpleBusLT16<1,2> bus1("bus1");
+  // FIR_STAGES=n chains n firTop stream stages, e.g. a multi-stage decimator
+  const char *stages = getenv("FIR_STAGES");
+  // Unit k answers at 0x70010000 + k*0x10000 (CPU view), the dispatcher
+  // right after the last unit
+  TlmToAxi *fir[FIR_UNITS];
+  for (int k=0; k<FIR_UNITS; k++)
+    fir[k] = new TlmToAxi(k ? ("tlm2axi" + std::to_string(k)).c_str() : "tlm2axi",
+                          stages ? atoi(stages) : 1);
+  dispatch disp("disp", FIR_UNITS, 0x10000, 0x10000);
+  // the bus-master ports of the units are initiators 2.. of bus0, so
+  // they reach every address the cpu does
+  SimpleBusLT<FIR_UNITS+2,2> bus0("bus0");
+  SimpleBusLT16<2,FIR_UNITS+2> bus1("bus1");
   dma dma0("dma0");
   cpu.master(bus0.target_socket[0]);
   dma0.master(bus0.target_socket[1]);
   bus0.initiator_socket[0](mem.slave);
   bus0.initiator_socket[1](bus1.target_socket[0]);
+  disp.master(bus1.target_socket[1]);
   bus1.initiator_socket[0](dma0.slave);
-  bus1.initiator_socket[1](tlm2axi.slave);
+  for (int k=0; k<FIR_UNITS; k++) {
+    fir[k]->bridge.master(bus0.target_socket[2+k]);
+    bus1.initiator_socket[1+k](fir[k]->slave);
+  }
+  bus1.initiator_socket[FIR_UNITS+1](disp.slave);
   sc_core::sc_start();
   time(&end_time);
   std::cout << "Simulation time: " << sc_core::sc_time_stamp() << std::endl
@@ -40,6 +40,12 @@ Room for improvement:
    is no addition of RCD or RP latencies or checking
    of read-after-write dependencies.
 
+ - The data port serves one transaction at a time, so
+   concurrent initiators (e.g. a cluster of firUnits)
+   queue behind each other.  The time the port was busy
+   is printed at the end of simulation to show how close
+   the memory is to saturation.
+
 **************************************************/
 
 #include "nvhls_pch.h"
@@ -66,6 +72,7 @@ memctl::memctl( sc_core::sc_module_name module_name, sc_dt::uint64 memory_size,
   : sc_module (module_name)
   , m_verbose (verbose)
   , m_memory_size (memory_size)
+  , m_busy (sc_core::SC_ZERO_TIME)
 {
   unsigned long i; 
   slave.register_b_transport(this, &memctl::custom_b_transport);
@@ -91,6 +98,14 @@ memctl::~memctl()
   delete data;
 }
 
+void memctl::end_of_simulation()
+{
+  double total=sc_core::sc_time_stamp().to_seconds();
+  cout << sc_object::name() << " busy " << m_busy << " of "
+       << sc_core::sc_time_stamp() << " ("
+       << (total > 0 ? 100.0*m_busy.to_seconds()/total : 0.0) << "%)" << endl;
+}
+
 #define CL  2
 #define CCD 1
 #define RCD 2
@@ -118,9 +133,13 @@ memctl::custom_b_transport
         // Assume WRITES are buffered and written later.
         // We need only consider the time for 8-byte transfers over the
         // 64-bit bus
+        wait(delay);
+        m_port.lock();
         cycles=(length/8 + length%8);
         mem_delay=sc_core::sc_time(cycles*CLK_PERIOD,sc_core::SC_NS);
-        wait(delay+mem_delay);
+        wait(mem_delay);
+        m_busy+=mem_delay;
+        m_port.unlock();
 	      if (!m_initialized[bank])
 	        m_initialized[bank]=true;
         m_last_addr[bank]=address;
@@ -142,6 +161,8 @@ memctl::custom_b_transport
       }
       case tlm::TLM_READ_COMMAND:
       {
+        wait(delay);
+        m_port.lock();
         bytes_per_read=(2*CCD*DATA_BITS/8);
         num_reads=(length/bytes_per_read + length%bytes_per_read);
         if (!m_initialized[bank]) {
@@ -158,7 +179,9 @@ memctl::custom_b_transport
           cycles=CCD*num_reads+CL+RCD+RP;
         m_last_addr[bank]=address;
         mem_delay=sc_core::sc_time(cycles*CLK_PERIOD,sc_core::SC_NS);
-        wait(delay+mem_delay);
+        wait(mem_delay);
+        m_busy+=mem_delay;
+        m_port.unlock();
         
         if (m_verbose) cout << sc_core::sc_time_stamp() << " " << sc_object::name();
         if (m_verbose) cout << " READ len:0x" << hex << length << " addr:0x" << address; 
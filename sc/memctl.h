@@ -26,12 +26,16 @@ class memctl: public sc_core::sc_module
   ~memctl();
 
   tlm_utils::simple_target_socket<memctl,64>  slave;
+
+  void end_of_simulation();
  
   private:
 	    
   bool m_initialized[4];
   sc_dt::uint64 m_memory_size,m_last_addr[4];
   unsigned char *data;
+  sc_core::sc_mutex m_port;   // one transaction at a time
+  sc_core::sc_time  m_busy;   // time the port was busy
 
   void custom_b_transport
   ( tlm::tlm_generic_payload &gp, sc_core::sc_time &delay );